@@ -65,6 +65,37 @@ get_colors (std::vector<Rays::Color>* colors, int argc, const Value* argv)
 	}
 }
 
+void
+get_bounds (std::vector<Rays::Bounds>* bounds, int argc, const Value* argv)
+{
+	bounds->clear();
+
+	if (argc <= 0)
+		return;
+
+	if (argv[0].is_num())
+	{
+		if (argc % 4 != 0)
+			argument_error(__FILE__, __LINE__);
+
+		bounds->reserve(argc / 4);
+		for (int i = 0; i < argc; i += 4)
+		{
+			bounds->emplace_back(
+				to<coord>(argv[i + 0]),
+				to<coord>(argv[i + 1]),
+				to<coord>(argv[i + 2]),
+				to<coord>(argv[i + 3]));
+		}
+	}
+	else
+	{
+		bounds->reserve(argc);
+		for (int i = 0; i < argc; ++i)
+			bounds->emplace_back(to<Rays::Bounds>(argv[i]));
+	}
+}
+
 static uint
 get_nsegment (Value nsegment)
 {
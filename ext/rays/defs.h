@@ -9,6 +9,7 @@
 #include "rays/defs.h"
 #include "rays/color.h"
 #include "rays/point.h"
+#include "rays/bounds.h"
 #include "rays/ruby/defs.h"
 
 
@@ -26,6 +27,8 @@ void get_points (std::vector<Rays::Point>* points, int argc, const Value* argv);
 
 void get_colors (std::vector<Rays::Color>* colors, int argc, const Value* argv);
 
+void get_bounds (std::vector<Rays::Bounds>* bounds, int argc, const Value* argv);
+
 void get_rect_args (
 	coord* x,  coord* y,  coord* w,  coord* h,
 	coord* lt, coord* rt, coord* lb, coord* rb, uint* nseg,
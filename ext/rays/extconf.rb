@@ -14,6 +14,7 @@ Xot::ExtConf.new Xot, Rucy, Rays do
     headers    << 'ruby.h'
     libs.unshift 'gdi32', 'opengl32', 'glew32'           if win32?
     libs.unshift 'SDL2', 'SDL2_ttf', 'GLEW', 'GL'        if linux? || wasm?
+    libs.unshift 'pthread'                               if linux?
     frameworks << 'AppKit' << 'OpenGL' << 'AVFoundation' if osx?
     $CPPFLAGS << ' -DRAYS_32BIT_PIXELS_STRING'           if RUBY_PLATFORM == 'x64-mingw-ucrt'
     $LDFLAGS  << ' -Wl,--out-implib=librays.dll.a'       if mingw? || cygwin?
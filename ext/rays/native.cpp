@@ -15,6 +15,7 @@ void Init_rays_polyline ();
 void Init_rays_polygon ();
 void Init_rays_bitmap ();
 void Init_rays_image ();
+void Init_rays_picture ();
 void Init_rays_font ();
 void Init_rays_shader ();
 void Init_rays_camera ();
@@ -43,6 +44,7 @@ Init_rays_ext ()
 	Init_rays_polygon();
 	Init_rays_bitmap();
 	Init_rays_image();
+	Init_rays_picture();
 	Init_rays_font();
 	Init_rays_shader();
 	Init_rays_camera();
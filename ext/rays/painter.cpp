@@ -7,6 +7,7 @@
 #include "rays/ruby/color.h"
 #include "rays/ruby/matrix.h"
 #include "rays/ruby/image.h"
+#include "rays/ruby/picture.h"
 #include "rays/ruby/font.h"
 #include "rays/ruby/shader.h"
 #include "defs.h"
@@ -228,6 +229,57 @@ RUCY_DEF6(ellipse, args, center, radius, hole, angle_from, angle_to)
 }
 RUCY_END
 
+static void
+get_bulk_args (
+	std::vector<Rays::Bounds>* bounds, std::vector<Rays::Color>* colors,
+	Value bounds_, Value colors_)
+{
+	get_bounds(bounds, bounds_.size(), bounds_.as_array());
+
+	if (colors_)
+	{
+		get_colors(colors, colors_.size(), colors_.as_array());
+		if (colors->size() != bounds->size())
+			argument_error(__FILE__, __LINE__, "colors.size() != bounds.size()");
+	}
+}
+
+static
+RUCY_DEF2(rects, bounds, colors)
+{
+	CHECK;
+
+	std::vector<Rays::Bounds> bounds_;
+	std::vector<Rays::Color>  colors_;
+	get_bulk_args(&bounds_, &colors_, bounds, colors);
+
+	if (!bounds_.empty())
+	{
+		THIS->rects(
+			&bounds_[0], colors_.empty() ? NULL : &colors_[0], bounds_.size());
+	}
+	return self;
+}
+RUCY_END
+
+static
+RUCY_DEF2(ellipses, bounds, colors)
+{
+	CHECK;
+
+	std::vector<Rays::Bounds> bounds_;
+	std::vector<Rays::Color>  colors_;
+	get_bulk_args(&bounds_, &colors_, bounds, colors);
+
+	if (!bounds_.empty())
+	{
+		THIS->ellipses(
+			&bounds_[0], colors_.empty() ? NULL : &colors_[0], bounds_.size());
+	}
+	return self;
+}
+RUCY_END
+
 static
 RUCY_DEF2(curve, args, loop)
 {
@@ -260,25 +312,33 @@ RUCY_DEF2(bezier, args, loop)
 }
 RUCY_END
 
-static
-RUCY_DEFN(image)
+static const Rays::Image*
+get_image (std::unique_ptr<Rays::Image>* pimage, Value value)
 {
-	CHECK;
-	check_arg_count(__FILE__, __LINE__, "Painter#image", argc, 1, 3, 5, 7, 9);
-
 	RUCY_SYM(to_image);
-	std::unique_ptr<Rays::Image> pimage;
 
 	const Rays::Image* image = NULL;
-	if (argv[0].is_a(Rays::image_class()))
-		image = to<Rays::Image*>(argv[0]);
-	else if (argv[0].respond_to(to_image))
+	if (value.is_a(Rays::image_class()))
+		image = to<Rays::Image*>(value);
+	else if (value.respond_to(to_image))
 	{
-		pimage.reset(new Rays::Image(to<const Rays::Image&>(argv[0].call(to_image))));
-		image = pimage.get();
+		pimage->reset(new Rays::Image(to<const Rays::Image&>(value.call(to_image))));
+		image = pimage->get();
 	}
 	if (!image)
-		argument_error(__FILE__, __LINE__, "%s is not an image.", argv[0].inspect().c_str());
+		argument_error(__FILE__, __LINE__, "%s is not an image.", value.inspect().c_str());
+
+	return image;
+}
+
+static
+RUCY_DEFN(image)
+{
+	CHECK;
+	check_arg_count(__FILE__, __LINE__, "Painter#image", argc, 1, 3, 5, 7, 9);
+
+	std::unique_ptr<Rays::Image> pimage;
+	const Rays::Image* image = get_image(&pimage, argv[0]);
 
 	if (argc == 1)
 		THIS->image(*image);
@@ -314,6 +374,48 @@ RUCY_DEFN(image)
 }
 RUCY_END
 
+static
+RUCY_DEF3(picture, picture, x, y)
+{
+	CHECK;
+
+	THIS->picture(to<Rays::Picture&>(picture), to<coord>(x), to<coord>(y));
+	return self;
+}
+RUCY_END
+
+static
+RUCY_DEF4(images, image, dest_bounds, src_bounds, colors)
+{
+	CHECK;
+
+	std::unique_ptr<Rays::Image> pimage;
+	const Rays::Image* image_ = get_image(&pimage, image);
+
+	std::vector<Rays::Bounds> dest_bounds_, src_bounds_;
+	std::vector<Rays::Color>  colors_;
+	get_bulk_args(&dest_bounds_, &colors_, dest_bounds, colors);
+
+	if (src_bounds)
+	{
+		get_bounds(&src_bounds_, src_bounds.size(), src_bounds.as_array());
+		if (src_bounds_.size() != dest_bounds_.size())
+			argument_error(__FILE__, __LINE__, "src_bounds.size() != dest_bounds.size()");
+	}
+
+	if (!dest_bounds_.empty())
+	{
+		THIS->images(
+			*image_,
+			src_bounds_.empty() ? NULL : &src_bounds_[0],
+			&dest_bounds_[0],
+			colors_.empty()     ? NULL : &colors_[0],
+			dest_bounds_.size());
+	}
+	return self;
+}
+RUCY_END
+
 static
 RUCY_DEFN(text)
 {
@@ -840,6 +942,118 @@ RUCY_DEF0(get_debug)
 }
 RUCY_END
 
+static
+RUCY_DEF0(get_statistics)
+{
+	CHECK;
+
+	const Rays::Painter::Statistics& st = THIS->statistics();
+	std::vector<Value> v = {
+		value(st.draws),
+		value(st.immediate_draws),
+		value(st.batched_draws),
+		value(st.draw_calls),
+		value(st.flushes),
+		value(st.flushes_by_blend),
+		value(st.flushes_by_clip),
+		value(st.flushes_by_shader),
+		value(st.flushes_by_uniform),
+		value(st.flushes_by_texture),
+		value(st.flushes_by_texcoord_mode),
+		value(st.flushes_by_texcoord_wrap),
+		value(st.flushes_by_text),
+		value(st.flushes_by_primitive),
+		value(st.flushes_by_capacity),
+		value(st.flushes_by_explicit),
+		value(st.uploaded_vertices),
+		value(st.uploaded_indices),
+		value(st.uploaded_bytes),
+		value(st.buffer_growths)
+	};
+	return array(&v[0], v.size());
+}
+RUCY_END
+
+static
+RUCY_DEF1(set_texture_atlas, state)
+{
+	CHECK;
+	if (state)
+		THIS->   add_flag(Rays::Painter::FLAG_TEXTURE_ATLAS);
+	else
+		THIS->remove_flag(Rays::Painter::FLAG_TEXTURE_ATLAS);
+	return state;
+}
+RUCY_END
+
+static
+RUCY_DEF0(get_texture_atlas)
+{
+	CHECK;
+	return value(THIS->has_flag(Rays::Painter::FLAG_TEXTURE_ATLAS));
+}
+RUCY_END
+
+static
+RUCY_DEF1(set_sdf_shapes, state)
+{
+	CHECK;
+	if (state)
+		THIS->   add_flag(Rays::Painter::FLAG_SDF_SHAPES);
+	else
+		THIS->remove_flag(Rays::Painter::FLAG_SDF_SHAPES);
+	return state;
+}
+RUCY_END
+
+static
+RUCY_DEF0(get_sdf_shapes)
+{
+	CHECK;
+	return value(THIS->has_flag(Rays::Painter::FLAG_SDF_SHAPES));
+}
+RUCY_END
+
+static
+RUCY_DEF1(set_gpu_strokes, state)
+{
+	CHECK;
+	if (state)
+		THIS->   add_flag(Rays::Painter::FLAG_GPU_STROKES);
+	else
+		THIS->remove_flag(Rays::Painter::FLAG_GPU_STROKES);
+	return state;
+}
+RUCY_END
+
+static
+RUCY_DEF0(get_gpu_strokes)
+{
+	CHECK;
+	return value(THIS->has_flag(Rays::Painter::FLAG_GPU_STROKES));
+}
+RUCY_END
+
+static
+RUCY_DEF1(set_glyph_atlas, state)
+{
+	CHECK;
+	if (state)
+		THIS->   add_flag(Rays::Painter::FLAG_GLYPH_ATLAS);
+	else
+		THIS->remove_flag(Rays::Painter::FLAG_GLYPH_ATLAS);
+	return state;
+}
+RUCY_END
+
+static
+RUCY_DEF0(get_glyph_atlas)
+{
+	CHECK;
+	return value(THIS->has_flag(Rays::Painter::FLAG_GLYPH_ATLAS));
+}
+RUCY_END
+
 static
 RUCY_DEF1(set_global_debug, debug)
 {
@@ -880,9 +1094,13 @@ Init_rays_painter ()
 	cPainter.define_private_method("polyline!", polyline);
 	cPainter.define_private_method("rect!",     rect);
 	cPainter.define_private_method("ellipse!",  ellipse);
+	cPainter.define_private_method("rects!",    rects);
+	cPainter.define_private_method("ellipses!", ellipses);
 	cPainter.define_private_method("curve!",    curve);
 	cPainter.define_private_method("bezier!",   bezier);
 	cPainter.define_method(        "image",     image);
+	cPainter.define_private_method("images!",   images);
+	cPainter.define_private_method("picture!",  picture);
 	cPainter.define_method(        "text",      text);
 
 	cPainter.define_method(   "background=", set_background);
@@ -939,6 +1157,15 @@ Init_rays_painter ()
 
 	cPainter.define_method("debug=", set_debug);
 	cPainter.define_method("debug?", get_debug);
+	cPainter.define_private_method("get_statistics", get_statistics);
+	cPainter.define_method("texture_atlas=", set_texture_atlas);
+	cPainter.define_method("texture_atlas?", get_texture_atlas);
+	cPainter.define_method("sdf_shapes=",    set_sdf_shapes);
+	cPainter.define_method("sdf_shapes?",    get_sdf_shapes);
+	cPainter.define_method("gpu_strokes=",   set_gpu_strokes);
+	cPainter.define_method("gpu_strokes?",   get_gpu_strokes);
+	cPainter.define_method("glyph_atlas=",   set_glyph_atlas);
+	cPainter.define_method("glyph_atlas?",   get_glyph_atlas);
 
 	cPainter.define_singleton_method("debug=", set_global_debug);
 	cPainter.define_singleton_method("debug?", get_global_debug);
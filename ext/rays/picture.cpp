@@ -0,0 +1,123 @@
+#include "rays/ruby/picture.h"
+
+
+#include "rays/ruby/painter.h"
+#include "defs.h"
+
+
+RUCY_DEFINE_VALUE_FROM_TO(RAYS_EXPORT, Rays::Picture)
+
+#define THIS  to<Rays::Picture*>(self)
+
+#define CHECK RUCY_CHECK_OBJECT(Rays::Picture, self)
+
+
+static
+RUCY_DEF_ALLOC(alloc, klass)
+{
+	return new_type<Rays::Picture>(klass);
+}
+RUCY_END
+
+static
+RUCY_DEF2(initialize, width, height)
+{
+	RUCY_CHECK_OBJ(Rays::Picture, self);
+
+	*THIS = Rays::Picture(to<coord>(width), to<coord>(height));
+	return self;
+}
+RUCY_END
+
+static
+RUCY_DEF1(initialize_copy, obj)
+{
+	RUCY_CHECK_OBJ(Rays::Picture, self);
+
+	*THIS = to<Rays::Picture&>(obj).dup();
+	return self;
+}
+RUCY_END
+
+static
+RUCY_DEF0(clear)
+{
+	CHECK;
+	THIS->clear();
+	return self;
+}
+RUCY_END
+
+static
+RUCY_DEF0(width)
+{
+	CHECK;
+	return value(THIS->width());
+}
+RUCY_END
+
+static
+RUCY_DEF0(height)
+{
+	CHECK;
+	return value(THIS->height());
+}
+RUCY_END
+
+static
+RUCY_DEF0(size)
+{
+	CHECK;
+	return value(THIS->size());
+}
+RUCY_END
+
+static
+RUCY_DEF0(is_empty)
+{
+	CHECK;
+	return value(THIS->empty());
+}
+RUCY_END
+
+static
+RUCY_DEF0(painter)
+{
+	CHECK;
+	return value(THIS->painter());
+}
+RUCY_END
+
+
+static Class cPicture;
+
+void
+Init_rays_picture ()
+{
+	Module mRays = define_module("Rays");
+
+	cPicture = mRays.define_class("Picture");
+	cPicture.define_alloc_func(alloc);
+	cPicture.define_private_method("initialize",      initialize);
+	cPicture.define_private_method("initialize_copy", initialize_copy);
+	cPicture.define_method("clear",  clear);
+	cPicture.define_method("width",  width);
+	cPicture.define_method("height", height);
+	cPicture.define_method("size",   size);
+	cPicture.define_method("empty?", is_empty);
+	cPicture.define_method("painter", painter);
+}
+
+
+namespace Rays
+{
+
+
+	Class
+	picture_class ()
+	{
+		return cPicture;
+	}
+
+
+}// Rays
@@ -1,6 +1,7 @@
 #include "rays/ruby/polygon.h"
 
 
+#include <memory>
 #include <vector>
 #include <functional>
 #include "rays/ruby/bounds.h"
@@ -64,6 +65,62 @@ RUCY_DEF0(bounds)
 }
 RUCY_END
 
+static
+RUCY_DEFN(contains)
+{
+	CHECK;
+	check_arg_count(__FILE__, __LINE__, "Polygon#contains?", argc, 1, 2);
+
+	return value(THIS->contains(to<Rays::Point>(argc, argv)));
+}
+RUCY_END
+
+static
+RUCY_DEF1(contains_points, points)
+{
+	CHECK;
+
+	CreateParams params(points, nil(), nil());
+	size_t size = params.size();
+
+	std::unique_ptr<bool[]> results(new bool[size]);
+	THIS->contains(results.get(), params.ppoints(), size);
+
+	std::vector<Value> v;
+	for (size_t i = 0; i < size; ++i)
+		v.emplace_back(value(results[i]));
+	return array(v.data(), v.size());
+}
+RUCY_END
+
+static
+RUCY_DEFN(is_near_outline)
+{
+	CHECK;
+	check_arg_count(__FILE__, __LINE__, "Polygon#near_outline?", argc, 2, 3);
+
+	const Rays::Point& point = to<Rays::Point>(argc - 1, argv);
+	coord distance           = to<coord>(argv[argc - 1]);
+
+	return value(THIS->is_near_outline(point, distance));
+}
+RUCY_END
+
+static
+RUCY_DEF0(triangulate)
+{
+	CHECK;
+
+	Rays::Polygon::TrianglePointList triangles;
+	THIS->triangulate(&triangles);
+
+	std::vector<Value> v;
+	for (const auto& point : triangles)
+		v.emplace_back(value(point));
+	return array(v.data(), v.size());
+}
+RUCY_END
+
 static
 RUCY_DEF0(size)
 {
@@ -121,6 +178,19 @@ each_poly (const Value& value, auto fun)
 		fun(to<T&>(array[i]));
 }
 
+static std::vector<Rays::Polygon>
+to_polygons (const Value& value, const Rays::Polygon* first = NULL)
+{
+	std::vector<Rays::Polygon> polygons;
+	if (first) polygons.emplace_back(*first);
+
+	each_poly<Rays::Polygon>(value, [&](const auto& polygon)
+	{
+		polygons.emplace_back(polygon);
+	});
+	return polygons;
+}
+
 static
 RUCY_DEF1(op_add, obj)
 {
@@ -168,12 +238,10 @@ RUCY_DEF1(op_sub, obj)
 
 	if (obj.is_array())
 	{
-		Rays::Polygon result = *THIS;
-		each_poly<Rays::Polygon>(obj, [&](const auto& polygon)
-		{
-			result = result - polygon;
-		});
-		return value(result);
+		if (obj.empty()) return self;
+
+		auto polygons = to_polygons(obj);
+		return value(*THIS - Rays::Polygon::unite(&polygons[0], polygons.size()));
 	}
 	else
 		return value(*THIS - to<Rays::Polygon&>(obj));
@@ -187,12 +255,8 @@ RUCY_DEF1(op_and, obj)
 
 	if (obj.is_array())
 	{
-		Rays::Polygon result = *THIS;
-		each_poly<Rays::Polygon>(obj, [&](const auto& polygon)
-		{
-			result = result & polygon;
-		});
-		return value(result);
+		auto polygons = to_polygons(obj, THIS);
+		return value(Rays::Polygon::intersect(&polygons[0], polygons.size()));
 	}
 	else
 		return value(*THIS & to<Rays::Polygon&>(obj));
@@ -206,12 +270,8 @@ RUCY_DEF1(op_or, obj)
 
 	if (obj.is_array())
 	{
-		Rays::Polygon result = *THIS;
-		each_poly<Rays::Polygon>(obj, [&](const auto& polygon)
-		{
-			result = result | polygon;
-		});
-		return value(result);
+		auto polygons = to_polygons(obj, THIS);
+		return value(Rays::Polygon::unite(&polygons[0], polygons.size()));
 	}
 	else
 		return value(*THIS | to<Rays::Polygon&>(obj));
@@ -237,6 +297,22 @@ RUCY_DEF1(op_xor, obj)
 }
 RUCY_END
 
+static
+RUCY_DEF1(unite, polygons)
+{
+	auto array = to_polygons(polygons);
+	return value(Rays::Polygon::unite(array.data(), array.size()));
+}
+RUCY_END
+
+static
+RUCY_DEF1(intersect, polygons)
+{
+	auto array = to_polygons(polygons);
+	return value(Rays::Polygon::intersect(array.data(), array.size()));
+}
+RUCY_END
+
 static
 RUCY_DEF1(create_points, points)
 {
@@ -374,6 +450,10 @@ Init_rays_polygon ()
 	cPolygon.define_private_method("setup", setup);
 	cPolygon.define_method("expand", expand);
 	cPolygon.define_method("bounds", bounds);
+	cPolygon.define_method("contains?",       contains);
+	cPolygon.define_method("contains_points", contains_points);
+	cPolygon.define_method("near_outline?",   is_near_outline);
+	cPolygon.define_method("triangulate",     triangulate);
 	cPolygon.define_method("size",   size);
 	cPolygon.define_method("empty?", is_empty);
 	cPolygon.define_method("[]", get_at);
@@ -383,6 +463,8 @@ Init_rays_polygon ()
 	cPolygon.define_method("&", op_and);
 	cPolygon.define_method("|", op_or);
 	cPolygon.define_method("^", op_xor);
+	cPolygon.define_singleton_method("unite!",          unite);
+	cPolygon.define_singleton_method("intersect!",      intersect);
 	cPolygon.define_singleton_method("points!",         create_points);
 	cPolygon.define_singleton_method("line!",           create_line);
 	cPolygon.define_singleton_method("lines!",          create_lines);
@@ -30,10 +30,15 @@ RUCY_DEF6(setup, points, loop, fill, colors, texcoords, hole)
 	CHECK;
 
 	CreateParams params(points, colors, texcoords);
-	*THIS = Rays::Polyline(
-		params.ppoints(), params.size(), loop, fill,
-		params.pcolors(), params.ptexcoords(),
-		hole);
+	if (!params.pcolors() && !params.ptexcoords())
+		*THIS = Rays::Polyline(std::move(params.points), loop, fill, hole);
+	else
+	{
+		*THIS = Rays::Polyline(
+			params.ppoints(), params.size(), loop, fill,
+			params.pcolors(), params.ptexcoords(),
+			hole);
+	}
 }
 RUCY_END
 
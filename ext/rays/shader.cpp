@@ -53,15 +53,19 @@ to_name_list (const Value& names, size_t index)
 }
 
 static std::shared_ptr<Rays::ShaderEnv>
-make_env (const Value& names, const Value& ignore_no_uniform_location_error)
+make_env (
+	const Value& names, const Value& ignore_no_uniform_location_error,
+	const Value& batchable)
 {
 	bool has_names = names && names.is_array() && !names.empty();
-	if (!has_names && !ignore_no_uniform_location_error)
+	if (!has_names && !ignore_no_uniform_location_error && !batchable)
 		return NULL;
 
 	uint flags = 0;
 	if (ignore_no_uniform_location_error)
 		flags |= Rays::ShaderEnv::IGNORE_NO_UNIFORM_LOCATION_ERROR;
+	if (batchable)
+		flags |= Rays::ShaderEnv::BATCHABLE;
 
 	return std::make_shared<Rays::ShaderEnv>(
 		to_name_list(names, 0),
@@ -82,9 +86,9 @@ make_env (const Value& names, const Value& ignore_no_uniform_location_error)
 }
 
 static
-RUCY_DEF4(setup,
+RUCY_DEF5(setup,
 	fragment_shader_source, vertex_shader_source,
-	builtin_variable_names, ignore_no_uniform_location_error)
+	builtin_variable_names, ignore_no_uniform_location_error, batchable)
 {
 	RUCY_CHECK_OBJ(Rays::Shader, self);
 
@@ -94,7 +98,8 @@ RUCY_DEF4(setup,
 	const char* fs = fragment_shader_source.c_str();
 	const char* vs = vertex_shader_source ? vertex_shader_source.c_str() : NULL;
 
-	auto env = make_env(builtin_variable_names, ignore_no_uniform_location_error);
+	auto env = make_env(
+		builtin_variable_names, ignore_no_uniform_location_error, batchable);
 	if (env)
 		*THIS = Rays::Shader(fs, vs, *env);
 	else
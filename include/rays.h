@@ -20,6 +20,7 @@
 #include <rays/polygon.h>
 #include <rays/bitmap.h>
 #include <rays/image.h>
+#include <rays/picture.h>
 #include <rays/font.h>
 #include <rays/shader.h>
 
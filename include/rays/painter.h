@@ -23,6 +23,7 @@ namespace Rays
 	class Image;
 	class Font;
 	class Shader;
+	class Picture;
 
 
 	class Painter
@@ -33,12 +34,66 @@ namespace Rays
 			enum Flag
 			{
 
-				FLAG_BATCHING = Xot::bit(0),
+				FLAG_BATCHING      = Xot::bit(0),
 
-				FLAG_LAST     = FLAG_BATCHING
+				FLAG_TEXTURE_ATLAS = Xot::bit(1),
+
+				FLAG_SDF_SHAPES    = Xot::bit(2),
+
+				FLAG_GPU_STROKES   = Xot::bit(3),
+
+				FLAG_GLYPH_ATLAS   = Xot::bit(4),
+
+				FLAG_LAST          = FLAG_GLYPH_ATLAS
 
 			};// Flag
 
+			struct Statistics
+			{
+
+				uint draws                    = 0;
+
+				uint immediate_draws          = 0;
+
+				uint batched_draws            = 0;
+
+				uint draw_calls               = 0;
+
+				uint flushes                  = 0;
+
+				uint flushes_by_blend         = 0;
+
+				uint flushes_by_clip          = 0;
+
+				uint flushes_by_shader        = 0;
+
+				uint flushes_by_uniform       = 0;
+
+				uint flushes_by_texture       = 0;
+
+				uint flushes_by_texcoord_mode = 0;
+
+				uint flushes_by_texcoord_wrap = 0;
+
+				uint flushes_by_text          = 0;
+
+				uint flushes_by_primitive     = 0;
+
+				uint flushes_by_capacity      = 0;
+
+				uint flushes_by_explicit      = 0;
+
+				size_t uploaded_vertices      = 0;
+
+				size_t uploaded_indices       = 0;
+
+				size_t uploaded_bytes         = 0;
+
+				// times that the buffers the painter reuses across draws grew
+				uint buffer_growths           = 0;
+
+			};// Statistics
+
 			Painter ();
 
 			~Painter ();
@@ -57,6 +112,8 @@ namespace Rays
 
 			void bind (const Image& image);
 
+			void bind (const Picture& picture);
+
 			void unbind ();
 
 			const Bounds& bounds () const;
@@ -134,6 +191,12 @@ namespace Rays
 				const Point& hole_radius = 0,
 				float angle_from = 0, float angle_to = 360);
 
+			// 'colors' are the fill colors for each shape, or NULL to use the
+			// current fill color.
+			void rects    (const Bounds* bounds, const Color* colors, size_t size);
+
+			void ellipses (const Bounds* bounds, const Color* colors, size_t size);
+
 			void curve (
 				coord x1, coord y1, coord x2, coord y2,
 				coord x3, coord y3, coord x4, coord y4,
@@ -190,6 +253,19 @@ namespace Rays
 				const Image& image,
 				const Bounds& src_bounds, const Bounds& dest_bounds);
 
+			// 'src_bounds' can be NULL to draw the whole image, and 'colors'
+			// can be NULL to use the current fill color.
+			void images (
+				const Image& image,
+				const Bounds* src_bounds, const Bounds* dest_bounds,
+				const Color* colors, size_t size);
+
+			void picture (
+				const Picture& picture, coord x = 0, coord y = 0);
+
+			void picture (
+				const Picture& picture, const Point& position);
+
 			void text (const char* str, coord x = 0, coord y = 0);
 
 			void text (const char* str, const Point& position);
@@ -332,6 +408,8 @@ namespace Rays
 			void pop_matrix ();
 
 
+			const Statistics& statistics () const;
+
 			void    add_flag (uint flags);
 
 			void remove_flag (uint flags);
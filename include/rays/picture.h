@@ -0,0 +1,62 @@
+// -*- c++ -*-
+#pragma once
+#ifndef __RAYS_PICTURE_H__
+#define __RAYS_PICTURE_H__
+
+
+#include <xot/pimpl.h>
+#include <rays/defs.h>
+#include <rays/painter.h>
+
+
+namespace Rays
+{
+
+
+	// A list of drawing commands that keeps the tessellated geometry and the
+	// states of each draw, so that it can be drawn again by Painter::picture()
+	// without building the shapes again. Recording does not touch OpenGL,
+	// so a picture can be recorded on any thread. Clipping is not recorded;
+	// the clip of the painter that draws the picture is used instead.
+	class Picture
+	{
+
+		typedef Picture This;
+
+		public:
+
+			Picture ();
+
+			Picture (coord width, coord height);
+
+			~Picture ();
+
+			Picture dup () const;
+
+			void clear ();
+
+			coord width () const;
+
+			coord height () const;
+
+			size_t size () const;
+
+			bool empty () const;
+
+			Painter painter ();
+
+			operator bool () const;
+
+			bool operator ! () const;
+
+			struct Data;
+
+			Xot::PSharedImpl<Data> self;
+
+	};// Picture
+
+
+}// Rays
+
+
+#endif//EOH
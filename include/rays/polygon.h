@@ -45,6 +45,14 @@ namespace Rays
 
 			Bounds bounds () const;
 
+			// Tests the points with the even-odd rule on the outlines to fill.
+			bool contains (const Point& point) const;
+
+			void contains (bool* results, const Point* points, size_t size) const;
+
+			// Returns true if any line of the polygon is within the distance.
+			bool is_near_outline (const Point& point, coord distance) const;
+
 			size_t size () const;
 
 			bool empty (bool deep = false) const;
@@ -71,17 +79,22 @@ namespace Rays
 
 			friend Polygon operator ^ (const Polygon& lhs, const Polygon& rhs);
 
-			struct Data;
+			// Unites or intersects all of the polygons at once. They are reduced
+			// in pairs, so that each clipping works on similar sized polygons.
+			static Polygon unite     (const Polygon* polygons, size_t size);
 
-			Xot::PSharedImpl<Data> self;
+			static Polygon intersect (const Polygon* polygons, size_t size);
 
 			typedef std::vector<Point> TrianglePointList;
 
-			Polygon (Data* data);
+			// Returns 3 points for each triangle of the outlines to fill.
+			bool triangulate (TrianglePointList* triangles) const;
 
-		protected:
+			struct Data;
 
-			bool triangulate (TrianglePointList* triangles) const;
+			Xot::PSharedImpl<Data> self;
+
+			Polygon (Data* data);
 
 	};// Polygon
 
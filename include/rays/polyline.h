@@ -26,7 +26,7 @@ namespace Rays
 
 			typedef std::vector<Point> PointList;
 
-			typedef PointList::const_iterator const_iterator;
+			typedef const Point* const_iterator;
 
 			Polyline ();
 
@@ -40,8 +40,18 @@ namespace Rays
 				const Color* colors = NULL, const Coord3* texcoords = NULL,
 				bool hole = false);
 
+			// Takes the points over without copying them.
+			Polyline (PointList&& points, bool loop, bool fill, bool hole = false);
+
 			~Polyline ();
 
+			// Refers to the arrays of the caller without copying them, so they
+			// have to outlive the polyline and the polygons made from it.
+			static Polyline view (
+				const Point* points, size_t size, bool loop, bool fill,
+				const Color* colors = NULL, const Coord3* texcoords = NULL,
+				bool hole = false);
+
 			bool expand (
 				Polygon* result,
 				coord width,
@@ -18,6 +18,7 @@
 #include <rays/ruby/polygon.h>
 #include <rays/ruby/bitmap.h>
 #include <rays/ruby/image.h>
+#include <rays/ruby/picture.h>
 #include <rays/ruby/font.h>
 #include <rays/ruby/shader.h>
 
@@ -0,0 +1,40 @@
+// -*- c++ -*-
+#pragma once
+#ifndef __RAYS_RUBY_PICTURE_H__
+#define __RAYS_RUBY_PICTURE_H__
+
+
+#include <rucy/class.h>
+#include <rucy/extension.h>
+#include <rays/picture.h>
+
+
+RUCY_DECLARE_VALUE_FROM_TO(RAYS_EXPORT, Rays::Picture)
+
+
+namespace Rays
+{
+
+
+	RAYS_EXPORT Rucy::Class picture_class ();
+	// class Rays::Picture
+
+
+}// Rays
+
+
+namespace Rucy
+{
+
+
+	template <> inline Class
+	get_ruby_class<Rays::Picture> ()
+	{
+		return Rays::picture_class();
+	}
+
+
+}// Rucy
+
+
+#endif//EOH
@@ -93,6 +93,12 @@ namespace Rays
 			enum Flags
 			{
 				IGNORE_NO_UNIFORM_LOCATION_ERROR = 0x1 << 0,
+
+				// Lets the painter batch the draws with the shader. Batched
+				// vertices are already transformed by the current matrix and
+				// the position matrix is the identity, so the shader has to
+				// draw the same without relying on the untransformed positions.
+				BATCHABLE                        = 0x1 << 1,
 			};
 
 			ShaderEnv (
@@ -12,6 +12,7 @@ require 'rays/polyline'
 require 'rays/polygon'
 require 'rays/bitmap'
 require 'rays/image'
+require 'rays/picture'
 require 'rays/font'
 require 'rays/shader'
 require 'rays/camera'
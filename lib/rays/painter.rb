@@ -67,6 +67,22 @@ module Rays
       rect! args, round, lt, rt, lb, rb
     end
 
+    def rects(bounds, colors: nil)
+      rects! bounds, colors
+    end
+
+    def ellipses(bounds, colors: nil)
+      ellipses! bounds, colors
+    end
+
+    def images(image, bounds, src: nil, colors: nil)
+      images! image, bounds, src, colors
+    end
+
+    def picture(picture, x = 0, y = 0)
+      picture! picture, x, y
+    end
+
     def ellipse(*args, center: nil, radius: nil, hole: nil, from: nil, to: nil)
       ellipse! args, center, radius, hole, from, to
     end
@@ -94,6 +110,36 @@ module Rays
       set_shader shader
     end
 
+    def statistics()
+      draws, immediate_draws, batched_draws, draw_calls,
+        flushes, blend, clip, shader, uniform, texture, texcoord_mode, texcoord_wrap, text, primitive, capacity, explicit,
+        vertices, indices, bytes, buffer_growths = get_statistics
+      {
+        draws:           draws,
+        immediate_draws: immediate_draws,
+        batched_draws:   batched_draws,
+        draw_calls:      draw_calls,
+        flushes:         flushes,
+        flush_reasons: {
+          blend:         blend,
+          clip:          clip,
+          shader:        shader,
+          uniform:       uniform,
+          texture:       texture,
+          texcoord_mode: texcoord_mode,
+          texcoord_wrap: texcoord_wrap,
+          text:          text,
+          primitive:     primitive,
+          capacity:      capacity,
+          explicit:      explicit
+        },
+        uploaded_vertices: vertices,
+        uploaded_indices:  indices,
+        uploaded_bytes:    bytes,
+        buffer_growths:    buffer_growths
+      }
+    end
+
     const_symbol_accessor :stroke_cap, **{
       butt:   CAP_BUTT,
       round:  CAP_ROUND,
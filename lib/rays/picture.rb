@@ -0,0 +1,21 @@
+require 'rays/ext'
+
+
+module Rays
+
+
+  class Picture
+
+    def paint(&block)
+      painter.paint self, &block
+      self
+    end
+
+    def bounds()
+      Bounds.new 0, 0, width, height
+    end
+
+  end# Picture
+
+
+end# Rays
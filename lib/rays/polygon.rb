@@ -33,6 +33,14 @@ module Rays
       "#<Rays::Polygon [#{map {|polyline| polyline.inspect}.join ', '}]>"
     end
 
+    def self.unite(*polygons)
+      unite! polygons.flatten
+    end
+
+    def self.intersect(*polygons)
+      intersect! polygons.flatten
+    end
+
     def self.points(*points)
       points! points
     end
@@ -12,6 +12,7 @@ module Rays
       vertex_shader_source   = nil,
       builtin_variable_names = nil,
       ignore_no_uniform_location_error: false,
+      batchable: false,
       **uniforms, &block)
 
       setup(
@@ -31,7 +32,8 @@ module Rays
           :uniform_texcoord_matrix,
           :uniform_texcoord_pixel,
           :uniform_texture),
-        ignore_no_uniform_location_error)
+        ignore_no_uniform_location_error,
+        batchable)
 
       uniform(**uniforms) unless uniforms.empty?
 
@@ -0,0 +1,254 @@
+#include "glyph_atlas.h"
+
+
+#include <math.h>
+#include <assert.h>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include "rays/bitmap.h"
+#include "rays/exception.h"
+#include "font.h"
+#include "bitmap.h"
+
+
+namespace Rays
+{
+
+
+	enum
+	{
+
+		ATLAS_SIZE = 1024,
+
+		GLYPH_GAP  = 1,
+
+		FONTS_MAX  = 32
+
+	};
+
+
+	struct GlyphAtlas
+	{
+
+		typedef std::unordered_map<uint32_t, Glyph> GlyphMap;
+
+		struct FontGlyphs
+		{
+
+			RawFont font;// holds the font so that its address is not reused
+
+			bool smooth;
+
+			GlyphMap glyphs;
+
+		};// FontGlyphs
+
+		float pixel_density;
+
+		Image image;
+
+		std::vector<std::unique_ptr<FontGlyphs>> fonts;
+
+		int x = 0, y = 0, row_height = 0;
+
+		GlyphAtlas (float pixel_density)
+		:	pixel_density(pixel_density)
+		{
+		}
+
+		void reset ()
+		{
+			image = Image();
+			fonts.clear();
+			x = y = row_height = 0;
+		}
+
+		FontGlyphs* get_font_glyphs (const RawFont& font, bool smooth)
+		{
+			for (auto& p : fonts)
+			{
+				if (p->font.self.get() == font.self.get() && p->smooth == smooth)
+					return p.get();
+			}
+
+			// each font keeps its raw font alive, so the atlas starts over
+			// instead of holding on to every font that has ever drawn text.
+			if (fonts.size() >= FONTS_MAX)
+				reset();
+
+			fonts.emplace_back(new FontGlyphs {font, smooth, {}});
+			return fonts.back().get();
+		}
+
+		bool allocate (int* alloc_x, int* alloc_y, int width, int height)
+		{
+			assert(alloc_x && alloc_y);
+
+			if (width > ATLAS_SIZE || height > ATLAS_SIZE)
+				return false;
+
+			if (x + width > ATLAS_SIZE)
+			{
+				x          = 0;
+				y         += row_height + GLYPH_GAP;
+				row_height = 0;
+			}
+			if (y + height > ATLAS_SIZE)
+				return false;
+
+			*alloc_x    = x;
+			*alloc_y    = y;
+			x          += width + GLYPH_GAP;
+			row_height  = std::max(row_height, height);
+			return true;
+		}
+
+		const Glyph* get_glyph (
+			FontGlyphs* fg, uint32_t codepoint, const char* str)
+		{
+			assert(fg && str);
+
+			auto it = fg->glyphs.find(codepoint);
+			if (it != fg->glyphs.end()) return &it->second;
+
+			const RawFont& font = fg->font;
+			coord advance       = font.get_width(str);
+			int w               = (int) ceil(advance);
+			int h               = (int) ceil(font.get_height());
+
+			Glyph glyph = {0, 0, 0, 0, advance};
+			if (w > 0 && h > 0 && codepoint != ' ' && codepoint != '\t')
+			{
+				int gx, gy;
+				if (!allocate(&gx, &gy, w, h))
+					return NULL;
+
+				if (!image)
+					image = Image(Bitmap(ATLAS_SIZE, ATLAS_SIZE), pixel_density);
+
+				Bitmap_draw_string(&image.bitmap(), font, str, gx, gy, fg->smooth);
+
+				glyph.x      = gx;
+				glyph.y      = gy;
+				glyph.width  = advance;
+				glyph.height = h;
+			}
+
+			return &fg->glyphs.emplace(codepoint, glyph).first->second;
+		}
+
+	};// GlyphAtlas
+
+
+	static std::vector<std::unique_ptr<GlyphAtlas>>*
+	get_atlases ()
+	{
+		static std::vector<std::unique_ptr<GlyphAtlas>> atlases;
+		return &atlases;
+	}
+
+	static GlyphAtlas*
+	get_atlas (float pixel_density)
+	{
+		auto& atlases = *get_atlases();
+
+		for (auto& atlas : atlases)
+		{
+			if (atlas->pixel_density == pixel_density)
+				return atlas.get();
+		}
+
+		atlases.emplace_back(new GlyphAtlas(pixel_density));
+		return atlases.back().get();
+	}
+
+	static size_t
+	decode_utf8 (uint32_t* codepoint, const char* str)
+	{
+		assert(codepoint && str && *str != '\0');
+
+		uchar c  = (uchar) str[0];
+		size_t n =
+			c < 0x80           ? 1 :
+			(c >> 5) == 0x06   ? 2 :
+			(c >> 4) == 0x0e   ? 3 :
+			(c >> 3) == 0x1e   ? 4 : 1;
+
+		uint32_t value = n == 1 ? c : (c & (0x7f >> n));
+		for (size_t i = 1; i < n; ++i)
+		{
+			uchar cc = (uchar) str[i];
+			if ((cc & 0xc0) != 0x80)
+			{
+				n = i;
+				break;
+			}
+			value = (value << 6) | (cc & 0x3f);
+		}
+
+		*codepoint = value;
+		return n;
+	}
+
+	static bool
+	get_glyphs (
+		std::vector<Glyph>* glyphs, GlyphAtlas* atlas,
+		const RawFont& font, bool smooth, const char* str)
+	{
+		GlyphAtlas::FontGlyphs* fg = atlas->get_font_glyphs(font, smooth);
+
+		char buffer[5];
+		for (const char* p = str; *p != '\0';)
+		{
+			uint32_t codepoint = 0;
+			size_t len         = decode_utf8(&codepoint, p);
+
+			std::copy(p, p + len, buffer);
+			buffer[len] = '\0';
+			p += len;
+
+			const Glyph* glyph = atlas->get_glyph(fg, codepoint, buffer);
+			if (!glyph) return false;
+
+			glyphs->emplace_back(*glyph);
+		}
+		return true;
+	}
+
+	bool
+	GlyphAtlas_get_glyphs (
+		std::vector<Glyph>* glyphs, Image* atlas,
+		const RawFont& font, bool smooth, const char* str, float pixel_density)
+	{
+		if (!glyphs || !atlas || !str)
+			argument_error(__FILE__, __LINE__);
+		if (!font)
+			argument_error(__FILE__, __LINE__);
+
+		GlyphAtlas* ga = get_atlas(pixel_density);
+		for (int retry = 0; retry < 2; ++retry)
+		{
+			glyphs->clear();
+			if (get_glyphs(glyphs, ga, font, smooth, str))
+			{
+				*atlas = ga->image;
+				return true;
+			}
+
+			// the atlas is full. painters still holding the texture of the old
+			// image keep drawing from it, so a fresh image can be started safely.
+			ga->reset();
+		}
+
+		return false;
+	}
+
+	void
+	GlyphAtlas_clear ()
+	{
+		get_atlases()->clear();
+	}
+
+
+}// Rays
@@ -0,0 +1,49 @@
+// -*- c++ -*-
+#pragma once
+#ifndef __RAYS_SRC_GLYPH_ATLAS_H__
+#define __RAYS_SRC_GLYPH_ATLAS_H__
+
+
+#include <vector>
+#include "rays/defs.h"
+#include "rays/image.h"
+
+
+namespace Rays
+{
+
+
+	class RawFont;
+
+
+	struct Glyph
+	{
+
+		coord x, y, width, height;// in the atlas image, in pixels
+
+		coord advance;// in pixels
+
+		bool visible () const
+		{
+			return width > 0 && height > 0;
+		}
+
+	};// Glyph
+
+
+	// Rasterizes the missing glyphs of 'str' into the shared atlas for the
+	// pixel density and returns all of them in order together with the
+	// atlas image they live in. Returns false if the glyphs cannot fit into
+	// an atlas, in which case the caller has to render the string by itself.
+	bool GlyphAtlas_get_glyphs (
+		std::vector<Glyph>* glyphs, Image* atlas,
+		const RawFont& font, bool smooth, const char* str, float pixel_density);
+
+	// Releases the atlases and the fonts they hold.
+	void GlyphAtlas_clear ();
+
+
+}// Rays
+
+
+#endif//EOH
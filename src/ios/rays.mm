@@ -5,6 +5,8 @@
 #import <Foundation/Foundation.h>
 #include "rays/exception.h"
 #include "../renderer.h"
+#include "../texture_atlas.h"
+#include "../glyph_atlas.h"
 
 
 namespace Rays
@@ -38,6 +40,10 @@ namespace Rays
 		if (!global::pool)
 			rays_error(__FILE__, __LINE__, "not initialized.");
 
+		// the atlas pages are textures of the context that goes away.
+		TextureAtlas_clear();
+		GlyphAtlas_clear();
+
 		Renderer_fin();
 
 		[global::pool release];
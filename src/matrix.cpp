@@ -1,6 +1,15 @@
 #include "matrix.h"
 
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define RAYS_MATRIX_SSE
+	#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define RAYS_MATRIX_NEON
+	#include <arm_neon.h>
+#endif
+
+#include <assert.h>
 #include <xot/util.h>
 #include "rays/exception.h"
 #include "rays/point.h"
@@ -49,6 +58,170 @@ namespace Rays
 	}
 
 
+	enum MatrixType
+	{
+
+		MATRIX_IDENTITY,
+
+		MATRIX_TRANSLATE,
+
+		MATRIX_AFFINE_2D,// x and y do not depend on z and vice versa
+
+		MATRIX_GENERAL
+
+	};// MatrixType
+
+
+	static MatrixType
+	get_type (const Matrix& m)
+	{
+		if (
+			m.w0 != 0 || m.w1 != 0 || m.w2 != 0 || m.w3 != 1 ||
+			m.x2 != 0 || m.y2 != 0 || m.z0 != 0 || m.z1 != 0)
+		{
+			return MATRIX_GENERAL;
+		}
+
+		if (m.x0 != 1 || m.y1 != 1 || m.z2 != 1 || m.y0 != 0 || m.x1 != 0)
+			return MATRIX_AFFINE_2D;
+
+		if (m.x3 != 0 || m.y3 != 0 || m.z3 != 0)
+			return MATRIX_TRANSLATE;
+
+		return MATRIX_IDENTITY;
+	}
+
+	static inline coord*
+	next (coord* p, size_t stride)
+	{
+		return (coord*) ((char*) p + stride);
+	}
+
+	template <int N>
+	static void
+	transform_general (
+		coord* r, size_t stride, const Matrix& m, const Coord3* points, size_t size)
+	{
+		static_assert(sizeof(coord) == sizeof(float));
+
+	#if defined(RAYS_MATRIX_SSE)
+		__m128 c0 = _mm_loadu_ps(m.column[0].array);
+		__m128 c1 = _mm_loadu_ps(m.column[1].array);
+		__m128 c2 = _mm_loadu_ps(m.column[2].array);
+		__m128 c3 = _mm_loadu_ps(m.column[3].array);
+		for (size_t i = 0; i < size; ++i, r = next(r, stride))
+		{
+			const Coord3& p = points[i];
+			__m128 v = _mm_add_ps(
+				_mm_add_ps(
+					_mm_mul_ps(c0, _mm_set1_ps(p.x)),
+					_mm_mul_ps(c1, _mm_set1_ps(p.y))),
+				_mm_add_ps(
+					_mm_mul_ps(c2, _mm_set1_ps(p.z)),
+					c3));
+			if (N == 4)
+				_mm_storeu_ps(r, v);
+			else
+				_mm_storel_pi((__m64*) r, v);
+		}
+	#elif defined(RAYS_MATRIX_NEON)
+		float32x4_t c0 = vld1q_f32(m.column[0].array);
+		float32x4_t c1 = vld1q_f32(m.column[1].array);
+		float32x4_t c2 = vld1q_f32(m.column[2].array);
+		float32x4_t c3 = vld1q_f32(m.column[3].array);
+		for (size_t i = 0; i < size; ++i, r = next(r, stride))
+		{
+			const Coord3& p = points[i];
+			float32x4_t v = vmlaq_n_f32(c3, c0, p.x);
+			v             = vmlaq_n_f32(v,  c1, p.y);
+			v             = vmlaq_n_f32(v,  c2, p.z);
+			if (N == 4)
+				vst1q_f32(r, v);
+			else
+				vst1_f32(r, vget_low_f32(v));
+		}
+	#else
+		const coord* a = m.array;
+		for (size_t i = 0; i < size; ++i, r = next(r, stride))
+		{
+			const Coord3& p = points[i];
+			for (int k = 0; k < N; ++k)
+				r[k] = a[k] * p.x + a[4 + k] * p.y + a[8 + k] * p.z + a[12 + k];
+		}
+	#endif
+	}
+
+	template <int N>
+	static void
+	transform_points (
+		coord* r, size_t stride, const Matrix& m, const Coord3* points, size_t size)
+	{
+		assert(r && points);
+
+		switch (get_type(m))
+		{
+			case MATRIX_IDENTITY:
+				for (size_t i = 0; i < size; ++i, r = next(r, stride))
+				{
+					const Coord3& p = points[i];
+					r[0] = p.x;
+					r[1] = p.y;
+					if (N == 4) {r[2] = p.z; r[3] = 1;}
+				}
+				break;
+
+			case MATRIX_TRANSLATE:
+				for (size_t i = 0; i < size; ++i, r = next(r, stride))
+				{
+					const Coord3& p = points[i];
+					r[0] = p.x + m.x3;
+					r[1] = p.y + m.y3;
+					if (N == 4) {r[2] = p.z + m.z3; r[3] = 1;}
+				}
+				break;
+
+	#if !defined(RAYS_MATRIX_SSE) && !defined(RAYS_MATRIX_NEON)
+			// with SIMD, the general path is cheaper than this one.
+			case MATRIX_AFFINE_2D:
+				for (size_t i = 0; i < size; ++i, r = next(r, stride))
+				{
+					const Coord3& p = points[i];
+					r[0] = m.x0 * p.x + m.x1 * p.y + m.x3;
+					r[1] = m.y0 * p.x + m.y1 * p.y + m.y3;
+					if (N == 4) {r[2] = m.z2 * p.z + m.z3; r[3] = 1;}
+				}
+				break;
+	#endif
+
+			default:
+				transform_general<N>(r, stride, m, points, size);
+				break;
+		}
+	}
+
+	void
+	Matrix_transform_points (
+		Coord4* results, size_t stride,
+		const Matrix& matrix, const Coord3* points, size_t size)
+	{
+		if (!results || !points)
+			argument_error(__FILE__, __LINE__);
+
+		transform_points<4>(results->array, stride, matrix, points, size);
+	}
+
+	void
+	Matrix_transform_points (
+		Coord2* results, size_t stride,
+		const Matrix& matrix, const Coord3* points, size_t size)
+	{
+		if (!results || !points)
+			argument_error(__FILE__, __LINE__);
+
+		transform_points<2>(results->array, stride, matrix, points, size);
+	}
+
+
 	Matrix::Matrix (coord value)
 	{
 		reset(value);
@@ -24,6 +24,19 @@ namespace Rays
 	inline const Matrix& to_rays (const Mat4&  val) {return *(const Matrix*) &val;}
 
 
+	// Transforms each point with w = 1 and writes the results to 'results',
+	// which advances by 'stride' bytes per point, so that they can be written
+	// straight into interleaved vertex data.
+	void Matrix_transform_points (
+		Coord4* results, size_t stride,
+		const Matrix& matrix, const Coord3* points, size_t size);
+
+	// Same as above, but only the x and y components are written.
+	void Matrix_transform_points (
+		Coord2* results, size_t stride,
+		const Matrix& matrix, const Coord3* points, size_t size);
+
+
 }// Rays
 
 
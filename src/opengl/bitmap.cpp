@@ -2,8 +2,8 @@
 
 
 #include "rays/exception.h"
-#include "../texture.h"
 #include "opengl.h"
+#include "texture.h"
 #include "color_space.h"
 #include "frame_buffer.h"
 
@@ -25,6 +25,8 @@ namespace Rays
 		GLenum format, type;
 		ColorSpace_get_gl_format_and_type(&format, &type, tex.color_space());
 
+		Texture_wait_for_pixels(tex);
+
 		FrameBuffer fb(tex);
 		FrameBufferBinder binder(fb.id());
 
@@ -6,6 +6,7 @@
 #include "rays/debug.h"
 #include "texture.h"
 #include "render_buffer.h"
+#include "opengl_state.h"
 
 
 namespace Rays
@@ -47,6 +48,8 @@ namespace Rays
 				GLuint id_ = id;
 				glDeleteFramebuffers(1, &id_);
 				OpenGL_check_error(__FILE__, __LINE__);
+
+				OpenGLState_forget_framebuffer(id_);
 			}
 
 			id = -1;
@@ -213,14 +216,9 @@ namespace Rays
 	void
 	FrameBuffer_bind (GLuint id)
 	{
-		GLuint current = 0;
-		glGetIntegerv(GL_FRAMEBUFFER_BINDING, (GLint*) &current);
-		OpenGL_check_error(__FILE__, __LINE__);
-
-		frame_buffer_bind_stack.push_back(current);
+		frame_buffer_bind_stack.push_back(OpenGLState_get_framebuffer());
 
-		glBindFramebuffer(GL_FRAMEBUFFER, id);
-		OpenGL_check_error(__FILE__, __LINE__);
+		OpenGLState_bind_framebuffer(id);
 	}
 
 	void
@@ -232,8 +230,7 @@ namespace Rays
 		GLuint id = frame_buffer_bind_stack.back();
 		frame_buffer_bind_stack.pop_back();
 
-		glBindFramebuffer(GL_FRAMEBUFFER, id);
-		OpenGL_check_error(__FILE__, __LINE__);
+		OpenGLState_bind_framebuffer(id);
 	}
 
 
@@ -5,6 +5,7 @@
 #import <OpenGLES/EAGL.h>
 #include "rays/rays.h"
 #include "rays/exception.h"
+#include "../opengl_state.h"
 
 
 namespace Rays
@@ -30,6 +31,13 @@ namespace Rays
 	void
 	Renderer_fin ()
 	{
+		OpenGLState_fin();
+	}
+
+	Context
+	Renderer_get_current_context ()
+	{
+		return [EAGLContext currentContext];
 	}
 
 
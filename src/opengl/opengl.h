@@ -17,6 +17,11 @@
 #include "rays/defs.h"
 
 
+#if defined(IOS) || (!defined(OSX) && !defined(WASM))
+	#define RAYS_FENCE_SYNC
+#endif
+
+
 namespace Rays
 {
 
@@ -0,0 +1,647 @@
+#include "opengl_state.h"
+
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "rays/exception.h"
+#include "../renderer.h"
+
+
+namespace Rays
+{
+
+
+	enum Field
+	{
+
+		VIEWPORT             = 1 << 0,
+
+		COLOR_CLEAR          = 1 << 1,
+
+		DEPTH_TEST           = 1 << 2,
+
+		DEPTH_FUNC           = 1 << 3,
+
+		SCISSOR_TEST         = 1 << 4,
+
+		SCISSOR_BOX          = 1 << 5,
+
+		BLEND                = 1 << 6,
+
+		BLEND_EQUATION       = 1 << 7,
+
+		BLEND_FUNC           = 1 << 8,
+
+		FRAMEBUFFER          = 1 << 9,
+
+		PROGRAM              = 1 << 10,
+
+		ARRAY_BUFFER         = 1 << 11,
+
+		ELEMENT_ARRAY_BUFFER = 1 << 12,
+
+		ACTIVE_TEXTURE       = 1 << 13,
+
+	};// Field
+
+
+	enum {TEXTURE_UNIT_MAX = 16};
+
+
+	struct Shadow
+	{
+
+		Context context = NULL;
+
+		OpenGLState state;
+
+		GLint program, array_buffer, element_array_buffer, active_texture;
+
+		GLint textures[TEXTURE_UNIT_MAX];
+
+		uint known = 0;
+
+		int depth  = 0;
+
+		bool is_known (uint field) const
+		{
+			return depth > 0 && (known & field) == field;
+		}
+
+		void invalidate ()
+		{
+			known = 0;
+			for (auto& id : textures) id = -1;
+		}
+
+	};// Shadow
+
+
+	// each context has its own shadow. the one in use belongs to the context
+	// that was current at the innermost OpenGLState_begin(), and outside of
+	// them the idle shadow, which is never trusted, is in use.
+	static Shadow idle_shadow;
+
+	static Shadow* shadow = &idle_shadow;
+
+	static std::vector<std::unique_ptr<Shadow>> shadows;
+
+	static std::vector<Shadow*> shadow_stack;
+
+
+	struct DeadObject
+	{
+
+		Context context;
+
+		GLuint buffer;
+
+		void* sync;
+
+	};// DeadObject
+
+
+	// buffers and syncs released while their context was not current;
+	// deleted at the next begin in that context.
+	static std::vector<DeadObject> dead_objects;
+
+	static Shadow*
+	get_shadow (Context context)
+	{
+		for (auto& s : shadows)
+		{
+			if (s->context == context)
+				return s.get();
+		}
+
+		// a shadow out of use is invalidated at the next begin anyway, so it
+		// can be taken over by another context.
+		for (auto& s : shadows)
+		{
+			if (s->depth == 0)
+			{
+				s->context = context;
+				return s.get();
+			}
+		}
+
+		shadows.emplace_back(new Shadow);
+		shadows.back()->context = context;
+		return shadows.back().get();
+	}
+
+
+	static void
+	enable (GLenum capability, bool enable)
+	{
+		if (enable)
+			glEnable(capability);
+		else
+			glDisable(capability);
+		OpenGL_check_error(__FILE__, __LINE__);
+	}
+
+	static GLint*
+	get_capability_field (GLenum capability, uint* field)
+	{
+		switch (capability)
+		{
+			case GL_DEPTH_TEST:   *field = DEPTH_TEST;   return &shadow->state.depth_test;
+			case GL_SCISSOR_TEST: *field = SCISSOR_TEST; return &shadow->state.scissor_test;
+			case GL_BLEND:        *field = BLEND;        return &shadow->state.blend;
+			default:              *field = 0;            return NULL;
+		}
+	}
+
+	static GLint*
+	get_buffer_field (GLenum target, uint* field)
+	{
+		switch (target)
+		{
+			case GL_ARRAY_BUFFER:
+				*field = ARRAY_BUFFER;
+				return &shadow->array_buffer;
+
+			case GL_ELEMENT_ARRAY_BUFFER:
+				*field = ELEMENT_ARRAY_BUFFER;
+				return &shadow->element_array_buffer;
+
+			default:
+				*field = 0;
+				return NULL;
+		}
+	}
+
+	static GLint*
+	get_texture_field ()
+	{
+		if (!shadow->is_known(ACTIVE_TEXTURE)) return NULL;
+
+		GLint unit = shadow->active_texture - GL_TEXTURE0;
+		if (unit < 0 || TEXTURE_UNIT_MAX <= unit) return NULL;
+
+		return &shadow->textures[unit];
+	}
+
+	static void
+	delete_buffer (GLuint id)
+	{
+		glDeleteBuffers(1, &id);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		OpenGLState_forget_buffer(id);
+	}
+
+	static void
+	delete_sync (void* sync)
+	{
+#ifdef RAYS_FENCE_SYNC
+		glDeleteSync((GLsync) sync);
+		OpenGL_check_error(__FILE__, __LINE__);
+#endif
+	}
+
+	static void
+	delete_dead_objects (Context context)
+	{
+		auto end = std::remove_if(
+			dead_objects.begin(), dead_objects.end(),
+			[&](const DeadObject& object)
+			{
+				if (object.context != context) return false;
+
+				if (object.buffer) delete_buffer(object.buffer);
+				if (object.sync)   delete_sync(object.sync);
+				return true;
+			});
+		dead_objects.erase(end, dead_objects.end());
+	}
+
+	static GLboolean
+	get_boolean (GLenum capability)
+	{
+		GLboolean value = GL_FALSE;
+		glGetBooleanv(capability, &value);
+		return value;
+	}
+
+
+	void
+	OpenGLState_begin ()
+	{
+		Context context = Renderer_get_current_context();
+		Shadow* s       = get_shadow(context);
+
+		// the shadow is not kept across the outermost begins. the host owns
+		// the context and may change its state in between without telling
+		// us, and a destroyed context's address may come back as a new one.
+		// so OpenGLState_get() queries the state once per outermost begin,
+		// and the draws in between are served from the shadow.
+		if (s->depth++ == 0)
+			s->invalidate();
+
+		if (!dead_objects.empty())
+			delete_dead_objects(context);
+
+		shadow_stack.push_back(s);
+		shadow = s;
+	}
+
+	void
+	OpenGLState_end ()
+	{
+		if (shadow_stack.empty())
+			invalid_state_error(__FILE__, __LINE__, "OpenGLState_end() underflow.");
+
+		Shadow* s = shadow_stack.back();
+		shadow_stack.pop_back();
+		if (--s->depth == 0)
+			s->invalidate();
+
+		shadow = shadow_stack.empty() ? &idle_shadow : shadow_stack.back();
+	}
+
+	const OpenGLState&
+	OpenGLState_get ()
+	{
+		OpenGLState& s = shadow->state;
+		if (shadow->depth == 0) shadow->invalidate();
+
+		uint& known = shadow->known;
+
+		if (!(known & VIEWPORT))
+			glGetIntegerv(GL_VIEWPORT, s.viewport);
+
+		if (!(known & COLOR_CLEAR))
+			glGetFloatv(GL_COLOR_CLEAR_VALUE, s.color_clear);
+
+		if (!(known & DEPTH_TEST))
+			s.depth_test = get_boolean(GL_DEPTH_TEST);
+		if (!(known & DEPTH_FUNC))
+			glGetIntegerv(GL_DEPTH_FUNC, &s.depth_func);
+
+		if (!(known & SCISSOR_TEST))
+			s.scissor_test = get_boolean(GL_SCISSOR_TEST);
+		if (!(known & SCISSOR_BOX))
+			glGetIntegerv(GL_SCISSOR_BOX, s.scissor_box);
+
+		if (!(known & BLEND))
+			s.blend = get_boolean(GL_BLEND);
+		if (!(known & BLEND_EQUATION))
+		{
+			glGetIntegerv(GL_BLEND_EQUATION_RGB,   &s.blend_equation_rgb);
+			glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &s.blend_equation_alpha);
+		}
+		if (!(known & BLEND_FUNC))
+		{
+			glGetIntegerv(GL_BLEND_SRC_RGB,   &s.blend_src_rgb);
+			glGetIntegerv(GL_BLEND_SRC_ALPHA, &s.blend_src_alpha);
+			glGetIntegerv(GL_BLEND_DST_RGB,   &s.blend_dst_rgb);
+			glGetIntegerv(GL_BLEND_DST_ALPHA, &s.blend_dst_alpha);
+		}
+
+		if (!(known & FRAMEBUFFER))
+			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &s.framebuffer_binding);
+
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		known |=
+			VIEWPORT | COLOR_CLEAR |
+			DEPTH_TEST | DEPTH_FUNC | SCISSOR_TEST | SCISSOR_BOX |
+			BLEND | BLEND_EQUATION | BLEND_FUNC | FRAMEBUFFER;
+		return s;
+	}
+
+	void
+	OpenGLState_restore (const OpenGLState& state)
+	{
+		const OpenGLState& s = state;
+
+		OpenGLState_viewport(
+			s.viewport[0], s.viewport[1], s.viewport[2], s.viewport[3]);
+
+		OpenGLState_clear_color(
+			s.color_clear[0], s.color_clear[1], s.color_clear[2], s.color_clear[3]);
+
+		OpenGLState_enable(GL_DEPTH_TEST, s.depth_test);
+		OpenGLState_depth_func(s.depth_func);
+
+		OpenGLState_enable(GL_SCISSOR_TEST, s.scissor_test);
+		OpenGLState_scissor(
+			s.scissor_box[0], s.scissor_box[1], s.scissor_box[2], s.scissor_box[3]);
+
+		OpenGLState_enable(GL_BLEND, s.blend);
+		OpenGLState_blend_equation(s.blend_equation_rgb, s.blend_equation_alpha);
+		OpenGLState_blend_func(
+			s.blend_src_rgb, s.blend_dst_rgb, s.blend_src_alpha, s.blend_dst_alpha);
+
+		OpenGLState_bind_framebuffer(s.framebuffer_binding);
+	}
+
+	void
+	OpenGLState_invalidate ()
+	{
+		shadow->invalidate();
+	}
+
+	void
+	OpenGLState_viewport (GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		GLint* v = shadow->state.viewport;
+		if (
+			shadow->is_known(VIEWPORT) &&
+			v[0] == x && v[1] == y && v[2] == width && v[3] == height)
+		{
+			return;
+		}
+
+		glViewport(x, y, width, height);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		v[0] = x;
+		v[1] = y;
+		v[2] = width;
+		v[3] = height;
+		shadow->known |= VIEWPORT;
+	}
+
+	void
+	OpenGLState_clear_color (
+		GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+	{
+		GLfloat* c = shadow->state.color_clear;
+		if (
+			shadow->is_known(COLOR_CLEAR) &&
+			c[0] == red && c[1] == green && c[2] == blue && c[3] == alpha)
+		{
+			return;
+		}
+
+		glClearColor(red, green, blue, alpha);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		c[0] = red;
+		c[1] = green;
+		c[2] = blue;
+		c[3] = alpha;
+		shadow->known |= COLOR_CLEAR;
+	}
+
+	void
+	OpenGLState_enable (GLenum capability, bool enable_)
+	{
+		uint field   = 0;
+		GLint* value = get_capability_field(capability, &field);
+		if (!value)
+			return enable(capability, enable_);
+
+		if (shadow->is_known(field) && *value == (GLint) enable_)
+			return;
+
+		enable(capability, enable_);
+
+		*value = enable_;
+		shadow->known |= field;
+	}
+
+	void
+	OpenGLState_depth_func (GLenum func)
+	{
+		GLint& value = shadow->state.depth_func;
+		if (shadow->is_known(DEPTH_FUNC) && value == (GLint) func)
+			return;
+
+		glDepthFunc(func);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		value = func;
+		shadow->known |= DEPTH_FUNC;
+	}
+
+	void
+	OpenGLState_scissor (GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		GLint* b = shadow->state.scissor_box;
+		if (
+			shadow->is_known(SCISSOR_BOX) &&
+			b[0] == x && b[1] == y && b[2] == width && b[3] == height)
+		{
+			return;
+		}
+
+		glScissor(x, y, width, height);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		b[0] = x;
+		b[1] = y;
+		b[2] = width;
+		b[3] = height;
+		shadow->known |= SCISSOR_BOX;
+	}
+
+	void
+	OpenGLState_blend_equation (GLenum rgb, GLenum alpha)
+	{
+		OpenGLState& s = shadow->state;
+		if (
+			shadow->is_known(BLEND_EQUATION) &&
+			s.blend_equation_rgb   == (GLint) rgb &&
+			s.blend_equation_alpha == (GLint) alpha)
+		{
+			return;
+		}
+
+		glBlendEquationSeparate(rgb, alpha);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		s.blend_equation_rgb   = rgb;
+		s.blend_equation_alpha = alpha;
+		shadow->known |= BLEND_EQUATION;
+	}
+
+	void
+	OpenGLState_blend_func (
+		GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha)
+	{
+		OpenGLState& s = shadow->state;
+		if (
+			shadow->is_known(BLEND_FUNC) &&
+			s.blend_src_rgb   == (GLint) src_rgb   &&
+			s.blend_dst_rgb   == (GLint) dst_rgb   &&
+			s.blend_src_alpha == (GLint) src_alpha &&
+			s.blend_dst_alpha == (GLint) dst_alpha)
+		{
+			return;
+		}
+
+		glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		s.blend_src_rgb   = src_rgb;
+		s.blend_dst_rgb   = dst_rgb;
+		s.blend_src_alpha = src_alpha;
+		s.blend_dst_alpha = dst_alpha;
+		shadow->known |= BLEND_FUNC;
+	}
+
+	GLuint
+	OpenGLState_get_framebuffer ()
+	{
+		GLint& value = shadow->state.framebuffer_binding;
+		if (!shadow->is_known(FRAMEBUFFER))
+		{
+			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &value);
+			OpenGL_check_error(__FILE__, __LINE__);
+
+			shadow->known |= FRAMEBUFFER;
+		}
+		return (GLuint) value;
+	}
+
+	void
+	OpenGLState_bind_framebuffer (GLuint id)
+	{
+		GLint& value = shadow->state.framebuffer_binding;
+		if (shadow->is_known(FRAMEBUFFER) && value == (GLint) id)
+			return;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, id);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		value = id;
+		shadow->known |= FRAMEBUFFER;
+	}
+
+	void
+	OpenGLState_use_program (GLuint id)
+	{
+		if (shadow->is_known(PROGRAM) && shadow->program == (GLint) id)
+			return;
+
+		glUseProgram(id);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		shadow->program = id;
+		shadow->known  |= PROGRAM;
+	}
+
+	void
+	OpenGLState_bind_buffer (GLenum target, GLuint id)
+	{
+		uint field   = 0;
+		GLint* value = get_buffer_field(target, &field);
+		if (value && shadow->is_known(field) && *value == (GLint) id)
+			return;
+
+		glBindBuffer(target, id);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		if (!value) return;
+		*value = id;
+		shadow->known |= field;
+	}
+
+	void
+	OpenGLState_active_texture (GLenum unit)
+	{
+		if (shadow->is_known(ACTIVE_TEXTURE) && shadow->active_texture == (GLint) unit)
+			return;
+
+		glActiveTexture(unit);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		shadow->active_texture = unit;
+		shadow->known         |= ACTIVE_TEXTURE;
+	}
+
+	void
+	OpenGLState_bind_texture (GLuint id)
+	{
+		GLint* value = get_texture_field();
+		if (value && *value == (GLint) id)
+			return;
+
+		glBindTexture(GL_TEXTURE_2D, id);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		if (value) *value = id;
+	}
+
+	// objects are shared between the contexts, so all the shadows forget them.
+
+	void
+	OpenGLState_forget_framebuffer (GLuint id)
+	{
+		for (auto& s : shadows)
+		{
+			if (s->state.framebuffer_binding == (GLint) id)
+				s->known &= ~FRAMEBUFFER;
+		}
+	}
+
+	void
+	OpenGLState_forget_program (GLuint id)
+	{
+		for (auto& s : shadows)
+		{
+			if (s->program == (GLint) id)
+				s->known &= ~PROGRAM;
+		}
+	}
+
+	void
+	OpenGLState_forget_buffer (GLuint id)
+	{
+		for (auto& s : shadows)
+		{
+			if (s->array_buffer == (GLint) id)
+				s->known &= ~ARRAY_BUFFER;
+			if (s->element_array_buffer == (GLint) id)
+				s->known &= ~ELEMENT_ARRAY_BUFFER;
+		}
+	}
+
+	void
+	OpenGLState_delete_buffer (Context context, GLuint id)
+	{
+		if (id == 0) return;
+
+		if (context == Renderer_get_current_context())
+			delete_buffer(id);
+		else if (context)
+			dead_objects.emplace_back(DeadObject {context, id, NULL});
+	}
+
+	void
+	OpenGLState_delete_sync (Context context, void* sync)
+	{
+		if (!sync) return;
+
+		if (context == Renderer_get_current_context())
+			delete_sync(sync);
+		else if (context)
+			dead_objects.emplace_back(DeadObject {context, 0, sync});
+	}
+
+	void
+	OpenGLState_fin ()
+	{
+		// the contexts go away together with the objects in them.
+		dead_objects.clear();
+	}
+
+	void
+	OpenGLState_forget_texture (GLuint id)
+	{
+		for (auto& s : shadows)
+		{
+			for (auto& value : s->textures)
+			{
+				if (value == (GLint) id) value = -1;
+			}
+		}
+	}
+
+
+}// Rays
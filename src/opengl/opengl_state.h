@@ -0,0 +1,108 @@
+// -*- c++ -*-
+#pragma once
+#ifndef __RAYS_SRC_OPENGL_OPENGL_STATE_H__
+#define __RAYS_SRC_OPENGL_OPENGL_STATE_H__
+
+
+#include "rays/rays.h"
+#include "opengl.h"
+
+
+namespace Rays
+{
+
+
+	struct OpenGLState
+	{
+
+		GLint viewport[4];
+
+		GLfloat color_clear[4];
+
+		GLint depth_test;
+		GLint depth_func;
+
+		GLint scissor_test;
+		GLint scissor_box[4];
+
+		GLint blend;
+		GLint blend_equation_rgb, blend_equation_alpha;
+		GLint blend_src_rgb, blend_src_alpha, blend_dst_rgb, blend_dst_alpha;
+
+		GLint framebuffer_binding;
+
+	};// OpenGLState
+
+
+	// The shadow state is trusted only between the outermost
+	// OpenGLState_begin() and OpenGLState_end(); outside of them every
+	// call below goes straight to the driver, because other code may
+	// touch the context at any time. The state is queried again once per
+	// outermost begin, not per draw. Each context that is current at
+	// OpenGLState_begin() has its own shadow, so the context must not be
+	// switched until the matching OpenGLState_end() without another begin.
+
+	void OpenGLState_begin ();
+
+	void OpenGLState_end ();
+
+	const OpenGLState& OpenGLState_get ();
+
+	void OpenGLState_restore (const OpenGLState& state);
+
+	void OpenGLState_invalidate ();
+
+	void OpenGLState_viewport (GLint x, GLint y, GLsizei width, GLsizei height);
+
+	void OpenGLState_clear_color (
+		GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+
+	void OpenGLState_enable (GLenum capability, bool enable = true);
+
+	void OpenGLState_depth_func (GLenum func);
+
+	void OpenGLState_scissor (GLint x, GLint y, GLsizei width, GLsizei height);
+
+	void OpenGLState_blend_equation (GLenum rgb, GLenum alpha);
+
+	void OpenGLState_blend_func (
+		GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+
+	GLuint OpenGLState_get_framebuffer ();
+
+	void OpenGLState_bind_framebuffer (GLuint id);
+
+	void OpenGLState_use_program (GLuint id);
+
+	void OpenGLState_bind_buffer (GLenum target, GLuint id);
+
+	void OpenGLState_active_texture (GLenum unit);
+
+	void OpenGLState_bind_texture (GLuint id);
+
+	void OpenGLState_forget_framebuffer (GLuint id);
+
+	void OpenGLState_forget_program (GLuint id);
+
+	void OpenGLState_forget_buffer (GLuint id);
+
+	void OpenGLState_forget_texture (GLuint id);
+
+	// Buffers may be released from destructors while no context or another
+	// one is current. The buffer is deleted right away if 'context', which
+	// it was created in, is current, or at the next OpenGLState_begin() in
+	// that context otherwise.
+	void OpenGLState_delete_buffer (Context context, GLuint id);
+
+	// Deletes the GLsync of a fence in the same way as the buffers above.
+	void OpenGLState_delete_sync (Context context, void* sync);
+
+	// Drops the objects still waiting for their contexts; called when the
+	// renderer finishes.
+	void OpenGLState_fin ();
+
+
+}// Rays
+
+
+#endif//EOH
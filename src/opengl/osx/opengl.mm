@@ -5,6 +5,7 @@
 #import <AppKit/AppKit.h>
 #include "rays/rays.h"
 #include "rays/exception.h"
+#include "../opengl_state.h"
 
 
 namespace Rays
@@ -47,6 +48,13 @@ namespace Rays
 	void
 	Renderer_fin ()
 	{
+		OpenGLState_fin();
+	}
+
+	Context
+	Renderer_get_current_context ()
+	{
+		return [NSOpenGLContext currentContext];
 	}
 
 
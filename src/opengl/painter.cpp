@@ -3,17 +3,21 @@
 
 #include <math.h>
 #include <assert.h>
+#include <stddef.h>
 #include <memory>
 #include <vector>
 #include <algorithm>
-#include <functional>
 #include "rays/exception.h"
 #include "../glm.h"
 #include "../coord.h"
 #include "../bitmap.h"
 #include "../image.h"
 #include "../font.h"
+#include "../glyph_atlas.h"
+#include "../picture.h"
+#include "../renderer.h"
 #include "opengl.h"
+#include "opengl_state.h"
 #include "texture.h"
 #include "frame_buffer.h"
 #include "shader.h"
@@ -29,117 +33,189 @@ namespace Rays
 	static const Texture INVALID_TEXTURE;
 
 
-	struct Vector4 : Coord4
+	class StreamBuffer
 	{
 
-		Vector4 (const Coord3& p) {Coord4::operator=(p);}
+		public:
 
-	};// Vector4
+			enum
+			{
+				CAPACITY_MIN = 256 * 1024,
 
+				ALIGNMENT    = 16
+			};
 
-	struct OpenGLState
-	{
+			StreamBuffer (GLenum target)
+			:	target(target)
+			{
+			}
 
-		GLint viewport[4];
+			~StreamBuffer ()
+			{
+				clear();
+			}
 
-		GLclampf color_clear[4];
+			GLintptr upload (const void* data, size_t size)
+			{
+				assert(data && size > 0);
 
-		GLboolean depth_test;
-		GLint depth_func;
+				size_t offset_ = align(offset);
+				if (id == 0 || offset_ + size > capacity)
+				{
+					orphan(size);
+					offset_ = 0;
+				}
+				else
+					bind();
 
-		GLboolean scissor_test;
-		GLint scissor_box[4];
+				glBufferSubData(target, (GLintptr) offset_, (GLsizeiptr) size, data);
+				OpenGL_check_error(__FILE__, __LINE__);
 
-		GLboolean blend;
-		GLint blend_equation_rgb, blend_equation_alpha;
-		GLint blend_src_rgb, blend_src_alpha, blend_dst_rgb, blend_dst_alpha;
+				offset = offset_ + size;
+				return (GLintptr) offset_;
+			}
 
-		GLint framebuffer_binding;
+			// makes sure that the next uploads of 'size' bytes in total,
+			// 'nparts' of them at most, go into the current storage. the
+			// storage is orphaned only here then, and the offsets returned by
+			// those uploads stay valid together.
+			void reserve (size_t size, size_t nparts = 1)
+			{
+				size += nparts * ALIGNMENT;
+				if (id == 0 || align(offset) + size > capacity)
+					orphan(size);
+			}
 
-		void push ()
-		{
-			glGetIntegerv(GL_VIEWPORT, viewport);
+			size_t reserved_size () const
+			{
+				return capacity;
+			}
 
-			glGetFloatv(GL_COLOR_CLEAR_VALUE, color_clear);
+			void bind () const
+			{
+				OpenGLState_bind_buffer(target, id);
+			}
 
-			glGetBooleanv(GL_DEPTH_TEST, &depth_test);
-			glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+			void unbind () const
+			{
+				OpenGLState_bind_buffer(target, 0);
+			}
 
-			glGetBooleanv(GL_SCISSOR_TEST, &scissor_test);
-			glGetIntegerv(GL_SCISSOR_BOX, scissor_box);
+			void clear ()
+			{
+				// the painter may be destroyed while no context is current.
+				OpenGLState_delete_buffer(context, id);
 
-			glGetBooleanv(GL_BLEND, &blend);
-			glGetIntegerv(GL_BLEND_EQUATION_RGB,   &blend_equation_rgb);
-			glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &blend_equation_alpha);
-			glGetIntegerv(GL_BLEND_SRC_RGB,   &blend_src_rgb);
-			glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend_src_alpha);
-			glGetIntegerv(GL_BLEND_DST_RGB,   &blend_dst_rgb);
-			glGetIntegerv(GL_BLEND_DST_ALPHA, &blend_dst_alpha);
+				context  = NULL;
+				id       = 0;
+				capacity = 0;
+				offset   = 0;
+			}
 
-			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer_binding);
-		}
+		private:
 
-		void pop ()
-		{
-			glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+			GLenum target;
 
-			glClearColor(
-				color_clear[0], color_clear[1], color_clear[2], color_clear[3]);
+			Context context = NULL;
 
-			enable(GL_DEPTH_TEST, depth_test);
-			glDepthFunc(depth_func);
+			GLuint id       = 0;
 
-			enable(GL_SCISSOR_TEST, scissor_test);
-			glScissor(scissor_box[0], scissor_box[1], scissor_box[2], scissor_box[3]);
+			size_t capacity = 0, offset = 0;
 
-			enable(GL_BLEND, blend);
-			glBlendEquationSeparate(blend_equation_rgb, blend_equation_alpha);
-			glBlendFuncSeparate(
-				blend_src_rgb, blend_dst_rgb, blend_src_alpha, blend_dst_alpha);
+			static size_t align (size_t n)
+			{
+				return (n + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1);
+			}
 
-			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_binding);
-		}
+			void orphan (size_t size)
+			{
+				if (id == 0)
+				{
+					glGenBuffers(1, &id);
+					OpenGL_check_error(__FILE__, __LINE__);
 
-		private:
+					context = Renderer_get_current_context();
+				}
 
-			void enable(GLenum type, GLboolean value)
-			{
-				if (value)
-					glEnable(type);
-				else
-					glDisable(type);
+				if (capacity < CAPACITY_MIN) capacity = CAPACITY_MIN;
+				while (capacity < size) capacity *= 2;
+
+				// re-specifying the storage detaches it from the draws still in
+				// flight, so the driver can hand out a fresh block without stalling.
+				bind();
+				glBufferData(target, (GLsizeiptr) capacity, NULL, GL_STREAM_DRAW);
+				OpenGL_check_error(__FILE__, __LINE__);
+
+				offset = 0;
 			}
 
-	};// OpenGLState
+			StreamBuffer (const StreamBuffer&) = delete;
+
+			StreamBuffer& operator = (const StreamBuffer&) = delete;
 
+	};// StreamBuffer
 
-	class DefaultIndices
+
+	enum
 	{
 
-		public:
+		// number of vertices that GL_UNSIGNED_SHORT indices can address.
+		INDEX16_VERTICES_MAX = 65536
 
-			void resize (size_t size)
-			{
-				indices.reserve(size);
-				while (indices.size() < size)
-					indices.emplace_back(indices.size());
-			}
+	};
 
-			void clear ()
-			{
-				decltype(indices)().swap(indices);
-			}
 
-			const uint* get () const
-			{
-				return &indices[0];
-			}
+	struct PackedColor
+	{
 
-		private:
+		uchar red, green, blue, alpha;
+
+	};// PackedColor
+
+
+	template <typename COLOR>
+	struct BatchVertexOf
+	{
+
+		Coord4 position;
+
+		COLOR  color;
+
+		Coord2 texcoord, texcoord_min, texcoord_max;
+
+	};// BatchVertexOf
+
+
+	// the builtin shaders draw into 8-bit targets, so their colors are
+	// packed to save bandwidth.
+	typedef BatchVertexOf<PackedColor> BatchVertex;
+
+	// user shaders get v_Color as painted, out of range values included.
+	typedef BatchVertexOf<Color>       FloatColorBatchVertex;
 
-			std::vector<uint> indices;
 
-	};// DefaultIndices
+	// vertex of the SDF shapes and the extruded strokes, whose shaders need
+	// more parameters than the texcoords of BatchVertex can carry.
+	struct ShapeVertex
+	{
+
+		Coord4 position;
+
+		uchar  color[4];
+
+		Coord4 texcoord;
+
+		Coord3 texcoord_min, texcoord_max;
+
+		void set_color (const uchar* rgba)
+		{
+			color[0] = rgba[0];
+			color[1] = rgba[1];
+			color[2] = rgba[2];
+			color[3] = rgba[3];
+		}
+
+	};// ShapeVertex
 
 
 	struct Batcher
@@ -149,8 +225,12 @@ namespace Rays
 
 		GLuint cached_texture_id = 0;
 
+		uint cached_uniform_version = 0;
+
 		int count = 0;
 
+		PrimitiveMode mode = MODE_TRIANGLES;
+
 		BlendMode blend_mode;
 
 		TexCoordMode texcoord_mode;
@@ -163,22 +243,21 @@ namespace Rays
 
 		Texture texture = INVALID_TEXTURE;
 
-		std::vector<Vector4> points;
-
-		std::vector<uint>    indices;
+		ShaderUniformSnapshot uniforms;// of the shader when the first vertex is batched
 
-		std::vector<Color>   colors;
+		std::vector<BatchVertex> vertices;
 
-		std::vector<Vector4> texcoords;
+		std::vector<FloatColorBatchVertex> float_color_vertices;
 
-		std::vector<Coord3>  texcoord_mins;
+		std::vector<ShapeVertex> shape_vertices;
 
-		std::vector<Coord3>  texcoord_maxes;
+		std::vector<ushort>      indices;
 
 		void init (const PainterState& state)
 		{
-			cached_shader_id  = 0;
-			cached_texture_id = 0;
+			cached_shader_id       = 0;
+			cached_texture_id      = 0;
+			cached_uniform_version = 0;
 			blend_mode        = state.blend_mode;
 			texcoord_mode     = state.texcoord_mode;
 			texcoord_wrap     = state.texcoord_wrap;
@@ -189,54 +268,95 @@ namespace Rays
 		{
 			shader  = INVALID_SHADER;
 			texture = INVALID_TEXTURE;
+			uniforms.reset();
+		}
+
+		void record_uniforms ()
+		{
+			if (uniforms) return;
+
+			const ShaderProgram* program = Shader_get_program(shader);
+			if (program) uniforms = ShaderProgram_get_uniform_snapshot(*program);
 		}
 
 		void clear_buffers ()
 		{
 			count = 0;
-			points        .clear();
+			uniforms.reset();
+			vertices            .clear();
+			float_color_vertices.clear();
+			shape_vertices      .clear();
 			indices       .clear();
-			colors        .clear();
-			texcoords     .clear();
-			texcoord_mins .clear();
-			texcoord_maxes.clear();
 		}
 
 	};// Batcher
 
 
+	template <typename T>
+	static inline size_t
+	get_reserved_size (const std::vector<T>& buffer)
+	{
+		return buffer.capacity() * sizeof(T);
+	}
+
+
 	struct PainterData : Painter::Data
 	{
 
 		FrameBuffer frame_buffer;
 
-		OpenGLState opengl_state;
-
-		DefaultIndices default_indices;
+		OpenGLState opengl_state;// state of the enclosing painter to restore at end()
 
 		std::vector<GLint> locations;
 
-		std::vector<GLuint> buffers;
+		StreamBuffer vertex_buffer {GL_ARRAY_BUFFER};
 
-		std::vector<GLuint> triangle_fan_indices_buffer;
+		StreamBuffer  index_buffer {GL_ELEMENT_ARRAY_BUFFER};
 
-		Batcher batcher;
+		std::vector<ushort> indices16;
 
-		GLuint create_and_bind_buffer (GLenum target, const void* data, GLsizeiptr size)
-		{
-			GLuint id = 0;
-			glGenBuffers(1, &id);
-			OpenGL_check_error(__FILE__, __LINE__);
+		std::vector<Coord3> texcoord_mins, texcoord_maxes;
 
-			buffers.push_back(id);
+		std::vector<Coord4> stroke_points;
 
-			glBindBuffer(target, id);
-			OpenGL_check_error(__FILE__, __LINE__);
+		std::vector<Color> color_array;
 
-			glBufferData(target, size, data, GL_STREAM_DRAW);
-			OpenGL_check_error(__FILE__, __LINE__);
+		Batcher batcher;
+
+		std::vector<Glyph> glyphs;
 
-			return id;
+		size_t buffers_size = 0;
+
+		void count_buffer_growth ()
+		{
+			size_t size =
+				get_reserved_size(state_stack)           +
+				get_reserved_size(position_matrix_stack) +
+				get_reserved_size(bulk_points)           +
+				get_reserved_size(bulk_texcoords)        +
+				get_reserved_size(bulk_texcoord_mins)    +
+				get_reserved_size(bulk_texcoord_maxes)   +
+				get_reserved_size(bulk_colors)           +
+				get_reserved_size(bulk_indices)          +
+				get_reserved_size(bulk_shape)            +
+				get_reserved_size(locations)             +
+				get_reserved_size(indices16)             +
+				get_reserved_size(texcoord_mins)         +
+				get_reserved_size(texcoord_maxes)        +
+				get_reserved_size(stroke_points)         +
+				get_reserved_size(color_array)           +
+				get_reserved_size(glyphs)                +
+				get_reserved_size(batcher.vertices)      +
+				get_reserved_size(batcher.float_color_vertices) +
+				get_reserved_size(batcher.shape_vertices)+
+				get_reserved_size(batcher.indices)       +
+				vertex_buffer.reserved_size()            +
+				 index_buffer.reserved_size();
+
+			// the buffers never shrink while painting, so any growth shows up
+			// in the total size.
+			if (size > buffers_size) ++statistics.buffer_growths;
+			buffers_size = size;
 		}
 
 		void cleanup ()
@@ -247,14 +367,7 @@ namespace Rays
 				OpenGL_check_error(__FILE__, __LINE__);
 			}
 
-			if (!buffers.empty())
-			{
-				glDeleteBuffers((GLsizei) buffers.size(), &buffers[0]);
-				OpenGL_check_error(__FILE__, __LINE__);
-			}
-
 			locations.clear();
-			buffers.clear();
 		}
 
 		void apply_blend_mode ()
@@ -262,57 +375,56 @@ namespace Rays
 			switch (state.blend_mode)
 			{
 				case BLEND_NORMAL:
-					glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-					glBlendFuncSeparate(
+					OpenGLState_blend_equation(GL_FUNC_ADD, GL_FUNC_ADD);
+					OpenGLState_blend_func(
 						GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_ADD:
-					glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
+					OpenGLState_blend_equation(GL_FUNC_ADD, GL_FUNC_ADD);
+					OpenGLState_blend_func(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_SUBTRACT:
-					glBlendEquationSeparate(GL_FUNC_REVERSE_SUBTRACT, GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
+					OpenGLState_blend_equation(GL_FUNC_REVERSE_SUBTRACT, GL_FUNC_ADD);
+					OpenGLState_blend_func(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_LIGHTEST:
-					glBlendEquationSeparate(GL_MAX, GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+					OpenGLState_blend_equation(GL_MAX, GL_FUNC_ADD);
+					OpenGLState_blend_func(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_DARKEST:
-					glBlendEquationSeparate(GL_MIN, GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+					OpenGLState_blend_equation(GL_MIN, GL_FUNC_ADD);
+					OpenGLState_blend_func(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_EXCLUSION:
-					glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-					glBlendFuncSeparate(
+					OpenGLState_blend_equation(GL_FUNC_ADD, GL_FUNC_ADD);
+					OpenGLState_blend_func(
 						GL_ONE_MINUS_DST_COLOR, GL_ONE_MINUS_SRC_COLOR, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_MULTIPLY:
-					glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_ZERO, GL_SRC_COLOR, GL_ONE, GL_ONE);
+					OpenGLState_blend_equation(GL_FUNC_ADD, GL_FUNC_ADD);
+					OpenGLState_blend_func(GL_ZERO, GL_SRC_COLOR, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_SCREEN:
-					glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_ONE_MINUS_DST_COLOR, GL_ONE, GL_ONE, GL_ONE);
+					OpenGLState_blend_equation(GL_FUNC_ADD, GL_FUNC_ADD);
+					OpenGLState_blend_func(GL_ONE_MINUS_DST_COLOR, GL_ONE, GL_ONE, GL_ONE);
 					break;
 
 				case BLEND_REPLACE:
-					glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_ONE, GL_ZERO, GL_ONE, GL_ZERO);
+					OpenGLState_blend_equation(GL_FUNC_ADD, GL_FUNC_ADD);
+					OpenGLState_blend_func(GL_ONE, GL_ZERO, GL_ONE, GL_ZERO);
 					break;
 
 				default:
 					argument_error(__FILE__, __LINE__, "unknown blend mode");
 					break;
 			}
-			OpenGL_check_error(__FILE__, __LINE__);
 		}
 
 		void apply_clipping ()
@@ -321,17 +433,15 @@ namespace Rays
 			if (clip)
 			{
 				coord y = frame_buffer ? clip.y : viewport.h - (clip.y + clip.h);
-				glEnable(GL_SCISSOR_TEST);
-				glScissor(
+				OpenGLState_enable(GL_SCISSOR_TEST);
+				OpenGLState_scissor(
 					pixel_density * clip.x,
 					pixel_density * y,
 					pixel_density * clip.width,
 					pixel_density * clip.height);
 			}
 			else
-				glDisable(GL_SCISSOR_TEST);
-
-			OpenGL_check_error(__FILE__, __LINE__);
+				OpenGLState_enable(GL_SCISSOR_TEST, false);
 		}
 
 	};// PainterData
@@ -344,58 +454,46 @@ namespace Rays
 	}
 
 	static void
-	apply_uniform (
-		const ShaderProgram& program, const char* name,
-		std::function<void(GLint)> apply_fun)
+	apply_uniform (const auto& locations, auto apply_fun)
 	{
-		GLint loc = glGetUniformLocation(program.id(), name);
-		if (loc < 0) return;
+		for (GLint loc : locations)
+		{
+			if (loc < 0) continue;
 
-		apply_fun(loc);
-		OpenGL_check_error(__FILE__, __LINE__);
+			apply_fun(loc);
+			OpenGL_check_error(__FILE__, __LINE__);
+		}
 	}
 
 	static void
 	apply_uniforms (
-		const ShaderProgram& program, const ShaderBuiltinVariableNames& names,
+		const ShaderBuiltinVariableLocations& locations,
 		const Matrix& position_matrix, const Matrix& texcoord_matrix,
 		const Texture* texture)
 	{
-		for (const auto& name : names.uniform_position_matrix_names)
-		{
-			apply_uniform(program, name, [&](GLint loc) {
-				glUniformMatrix4fv(loc, 1, GL_FALSE, position_matrix.array);
-			});
-		}
-		for (const auto& name : names.uniform_texcoord_matrix_names)
-		{
-			apply_uniform(program, name, [&](GLint loc) {
-				glUniformMatrix4fv(loc, 1, GL_FALSE, texcoord_matrix.array);
-			});
-		}
+		apply_uniform(locations.uniform_position_matrix_locations, [&](GLint loc) {
+			glUniformMatrix4fv(loc, 1, GL_FALSE, position_matrix.array);
+		});
+		apply_uniform(locations.uniform_texcoord_matrix_locations, [&](GLint loc) {
+			glUniformMatrix4fv(loc, 1, GL_FALSE, texcoord_matrix.array);
+		});
 
 		if (texture && *texture)
 		{
 			Point pixel_size(
 				1 / texture->reserved_width(),
 				1 / texture->reserved_height());
-			for (const auto& name : names.uniform_texcoord_pixel_names)
-			{
-				apply_uniform(
-					program, name, [&](GLint loc) {glUniform3fv(loc, 1, pixel_size.array);});
-			}
-			for (const auto& name : names.uniform_texture_names)
-			{
-				apply_uniform(program, name, [&](GLint loc) {
-					glActiveTexture(GL_TEXTURE0);
-					OpenGL_check_error(__FILE__, __LINE__);
+			apply_uniform(locations.uniform_texcoord_pixel_locations, [&](GLint loc) {
+				glUniform3fv(loc, 1, pixel_size.array);
+			});
+			apply_uniform(locations.uniform_texture_locations, [&](GLint loc) {
+				Texture_wait_for_drawing(*texture);
 
-					glBindTexture(GL_TEXTURE_2D, Texture_get_id(*texture));
-					OpenGL_check_error(__FILE__, __LINE__);
+				OpenGLState_active_texture(GL_TEXTURE0);
+				OpenGLState_bind_texture(Texture_get_id(*texture));
 
-					glUniform1i(loc, 0);
-				});
-			}
+				glUniform1i(loc, 0);
+			});
 		}
 	}
 
@@ -410,58 +508,49 @@ namespace Rays
 	}
 
 	static void
-	apply_attribute (
-		const ShaderProgram& program, const char* name,
-		std::function<void(GLint)> apply_fun)
+	apply_attribute (const auto& locations, auto apply_fun)
 	{
-		GLint loc = glGetAttribLocation(program.id(), name);
-		if (loc < 0) return;
+		for (GLint loc : locations)
+		{
+			if (loc < 0) continue;
 
-		apply_fun(loc);
-		OpenGL_check_error(__FILE__, __LINE__);
+			apply_fun(loc);
+			OpenGL_check_error(__FILE__, __LINE__);
+		}
 	}
 
 	template <typename CoordN>
 	static void
 	apply_attribute (
-		PainterData* self,
-		const ShaderProgram& program, const auto& names,
+		PainterData* self, const ShaderBuiltinVariableLocations::LocationList& locations,
 		const CoordN* values, size_t nvalues)
 	{
-		GLuint buffer = 0;
-		for (const auto& name : names)
-		{
-			#ifndef IOS
-				if (buffer == 0)
-				{
-					buffer = self->create_and_bind_buffer(
-						GL_ARRAY_BUFFER, values, sizeof(CoordN) * nvalues);
-					values = 0;
-				}
-			#endif
+		if (locations.empty()) return;
 
-			apply_attribute(program, name, [&](GLint loc)
-			{
-				glEnableVertexAttribArray(loc);
-				OpenGL_check_error(
-					__FILE__, __LINE__, "loc: %d %s\n", loc, name.c_str());
+		self->statistics.uploaded_bytes += sizeof(CoordN) * nvalues;
 
-				glVertexAttribPointer(
-					loc, CoordN::SIZE, get_gl_type<coord>(), GL_FALSE, 0, values);
+		#ifndef IOS
+			GLintptr offset = self->vertex_buffer.upload(
+				values, sizeof(CoordN) * nvalues);
+			values = (const CoordN*) offset;
+		#endif
 
-				self->locations.push_back(loc);
-			});
-		}
+		apply_attribute(locations, [&](GLint loc)
+		{
+			glEnableVertexAttribArray(loc);
+			OpenGL_check_error(__FILE__, __LINE__, "loc: %d\n", loc);
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		OpenGL_check_error(__FILE__, __LINE__);
+			glVertexAttribPointer(
+				loc, CoordN::SIZE, get_gl_type<coord>(), GL_FALSE, 0, values);
+
+			self->locations.push_back(loc);
+		});
 	}
 
 	template <typename CoordN>
 	static void
 	apply_attributes (
-		PainterData* self,
-		const ShaderProgram& program, const ShaderBuiltinVariableNames& names,
+		PainterData* self, const ShaderBuiltinVariableLocations& locations,
 		const CoordN* points, size_t npoints,
 		const Color* color, const Color* colors,
 		const CoordN* texcoords,
@@ -471,94 +560,197 @@ namespace Rays
 		assert(npoints > 0);
 		assert(!!color != !!colors);
 
+		self->statistics.uploaded_vertices += npoints;
+
+		#ifndef IOS
+		{
+			size_t size = 0, nparts = 0;
+			auto add_part = [&](const auto& locations_, size_t value_size)
+			{
+				if (locations_.empty()) return;
+				size += value_size * npoints;
+				++nparts;
+			};
+			add_part(locations.attribute_position_locations, sizeof(CoordN));
+			add_part(locations.attribute_texcoord_locations, sizeof(CoordN));
+			bool upload_colors = colors;
+			#if defined(GL_VERSION_2_1) && !defined(GL_VERSION_3_0)
+				upload_colors = colors || color;
+			#endif
+			if (upload_colors)
+				add_part(locations.attribute_color_locations, sizeof(Coord4));
+			if (texcoord_mins)
+				add_part(locations.attribute_texcoord_min_locations, sizeof(Coord3));
+			if (texcoord_maxes)
+				add_part(locations.attribute_texcoord_max_locations, sizeof(Coord3));
+
+			// the attributes are uploaded one by one, and orphaning the buffer
+			// in between would detach the ones uploaded before.
+			if (size > 0) self->vertex_buffer.reserve(size, nparts);
+		}
+		#endif
+
 		apply_attribute(
-			self, program, names.attribute_position_names,
-			points, npoints);
+			self, locations.attribute_position_locations, points, npoints);
 
 		if (colors)
 		{
 			apply_attribute(
-				self, program, names.attribute_color_names,
-				colors, npoints);
+				self, locations.attribute_color_locations, colors, npoints);
 		}
 		else if (color)
 		{
 #if defined(GL_VERSION_2_1) && !defined(GL_VERSION_3_0)
 			// to fix that GL 2.1 with glVertexAttrib4fv() draws nothing
 			// with specific glsl 'attribute' name.
-			std::vector<Color> colors_(npoints, *color);
+			self->color_array.assign(npoints, *color);
 			apply_attribute(
-				self, program, names.attribute_color_names,
-				(const Coord4*) &colors_[0], npoints);
+				self, locations.attribute_color_locations,
+				(const Coord4*) &self->color_array[0], npoints);
 #else
-			for (const auto& name : names.attribute_color_names)
-			{
-				apply_attribute(
-					program, name, [&](GLint loc) {glVertexAttrib4fv(loc, color->array);});
-			}
+			apply_attribute(locations.attribute_color_locations, [&](GLint loc) {
+				glVertexAttrib4fv(loc, color->array);
+			});
 #endif
 		}
 
 		apply_attribute(
-			self, program, names.attribute_texcoord_names,
+			self, locations.attribute_texcoord_locations,
 			texcoords ? texcoords : points, npoints);
 
 		if (texcoord_mins)
 		{
 			apply_attribute(
-				self, program, names.attribute_texcoord_min_names,
+				self, locations.attribute_texcoord_min_locations,
 				texcoord_mins, npoints);
 		}
 		else if (texcoord_min)
 		{
-			for (const auto& name : names.attribute_texcoord_min_names)
-			{
-				apply_attribute(
-					program, name, [&](GLint loc) {glVertexAttrib3fv(loc, texcoord_min->array);});
-			}
+			apply_attribute(locations.attribute_texcoord_min_locations, [&](GLint loc) {
+				glVertexAttrib3fv(loc, texcoord_min->array);
+			});
 		}
 
 		if (texcoord_maxes)
 		{
 			apply_attribute(
-				self, program, names.attribute_texcoord_max_names,
+				self, locations.attribute_texcoord_max_locations,
 				texcoord_maxes, npoints);
 		}
 		else if (texcoord_max)
 		{
-			for (const auto& name : names.attribute_texcoord_max_names)
-			{
-				apply_attribute(
-					program, name, [&](GLint loc) {glVertexAttrib3fv(loc, texcoord_max->array);});
-			}
+			apply_attribute(locations.attribute_texcoord_max_locations, [&](GLint loc) {
+				glVertexAttrib3fv(loc, texcoord_max->array);
+			});
 		}
 	}
 
 	static void
-	draw_indices (
-		PainterData* self, PrimitiveMode mode,
-		const uint* indices, size_t nindices, size_t npoints)
+	apply_attribute (
+		PainterData* self, const ShaderBuiltinVariableLocations::LocationList& locations,
+		const GLbyte* base, GLint size, GLenum type, GLboolean normalize,
+		GLsizei stride)
 	{
-		if (!indices || nindices <= 0)
+		apply_attribute(locations, [&](GLint loc)
 		{
-			self->default_indices.resize(npoints);
-			indices  = self->default_indices.get();
-			nindices = npoints;
-		}
+			glEnableVertexAttribArray(loc);
+			OpenGL_check_error(__FILE__, __LINE__, "loc: %d\n", loc);
+
+			glVertexAttribPointer(loc, size, type, normalize, stride, base);
+
+			self->locations.push_back(loc);
+		});
+	}
+
+	template <typename VERTEX>
+	static void
+	apply_attributes (
+		PainterData* self, const ShaderBuiltinVariableLocations& locations,
+		const VERTEX* vertices, size_t nvertices)
+	{
+		assert(vertices && nvertices > 0);
+
+		self->statistics.uploaded_vertices += nvertices;
+		self->statistics.uploaded_bytes    += sizeof(VERTEX) * nvertices;
+
+		const GLbyte* base = (const GLbyte*) vertices;
+		#ifndef IOS
+			base = (const GLbyte*) self->vertex_buffer.upload(
+				vertices, sizeof(VERTEX) * nvertices);
+		#endif
+
+		static const GLint TEXCOORD     = sizeof(VERTEX::texcoord)     / sizeof(coord);
+		static const GLint TEXCOORD_MIN = sizeof(VERTEX::texcoord_min) / sizeof(coord);
+		static const GLint TEXCOORD_MAX = sizeof(VERTEX::texcoord_max) / sizeof(coord);
+		static const GLsizei STRIDE     = sizeof(VERTEX);
+		static const bool FLOAT_COLOR   = sizeof(VERTEX::color) == sizeof(Color);
+		static const GLenum COLOR_TYPE  = FLOAT_COLOR ? GL_FLOAT : GL_UNSIGNED_BYTE;
+		static const GLboolean COLOR_NORMALIZE = FLOAT_COLOR ? GL_FALSE : GL_TRUE;
+
+		apply_attribute(
+			self, locations.attribute_position_locations,
+			base + offsetof(VERTEX, position),     4,            GL_FLOAT,         GL_FALSE, STRIDE);
+		apply_attribute(
+			self, locations.attribute_color_locations,
+			base + offsetof(VERTEX, color),        4,            COLOR_TYPE, COLOR_NORMALIZE, STRIDE);
+		apply_attribute(
+			self, locations.attribute_texcoord_locations,
+			base + offsetof(VERTEX, texcoord),     TEXCOORD,     GL_FLOAT,         GL_FALSE, STRIDE);
+		apply_attribute(
+			self, locations.attribute_texcoord_min_locations,
+			base + offsetof(VERTEX, texcoord_min), TEXCOORD_MIN, GL_FLOAT,         GL_FALSE, STRIDE);
+		apply_attribute(
+			self, locations.attribute_texcoord_max_locations,
+			base + offsetof(VERTEX, texcoord_max), TEXCOORD_MAX, GL_FLOAT,         GL_FALSE, STRIDE);
+	}
+
+	template <typename INDEX>
+	static void
+	draw_elements (
+		PainterData* self, PrimitiveMode mode, const INDEX* indices, size_t nindices)
+	{
+		static_assert(sizeof(INDEX) == 2 || sizeof(INDEX) == 4);
+		static const GLenum TYPE =
+			sizeof(INDEX) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+		Painter::Statistics& st = self->statistics;
+		st.uploaded_indices    += nindices;
+		st.uploaded_bytes      += sizeof(INDEX) * nindices;
+		++st.draw_calls;
 
 		#ifdef IOS
-			glDrawElements((GLenum) mode, (GLsizei) nindices, GL_UNSIGNED_INT, indices);
+			glDrawElements((GLenum) mode, (GLsizei) nindices, TYPE, indices);
 			OpenGL_check_error(__FILE__, __LINE__);
 		#else
-			self->create_and_bind_buffer(
-				GL_ELEMENT_ARRAY_BUFFER, indices, sizeof(uint) * nindices);
+			GLintptr offset = self->index_buffer.upload(
+				indices, sizeof(INDEX) * nindices);
 
-			glDrawElements((GLenum) mode, (GLsizei) nindices, GL_UNSIGNED_INT, 0);
+			glDrawElements(
+				(GLenum) mode, (GLsizei) nindices, TYPE, (const GLvoid*) offset);
 			OpenGL_check_error(__FILE__, __LINE__);
+		#endif
+	}
+
+	static void
+	draw_indices (
+		PainterData* self, PrimitiveMode mode,
+		const uint* indices, size_t nindices, size_t npoints)
+	{
+		if (!indices || nindices <= 0)
+		{
+			++self->statistics.draw_calls;
 
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			glDrawArrays((GLenum) mode, 0, (GLsizei) npoints);
 			OpenGL_check_error(__FILE__, __LINE__);
-		#endif
+		}
+		else if (npoints <= INDEX16_VERTICES_MAX)
+		{
+			auto& indices16 = self->indices16;
+			indices16.assign(indices, indices + nindices);
+			draw_elements(self, mode, &indices16[0], nindices);
+		}
+		else
+			draw_elements(self, mode, indices, nindices);
 	}
 
 	static void
@@ -580,6 +772,27 @@ namespace Rays
 		max->reset(texinfo.max.x / tw, texinfo.max.y / th);
 	}
 
+	static void
+	setup_texcoord_ranges (
+		std::vector<Coord3>* mins, std::vector<Coord3>* maxes,
+		const TextureInfo& texinfo, size_t npoints)
+	{
+		assert(mins && maxes && texinfo.point_mins && texinfo.point_maxes);
+
+		coord tw = texinfo.texture.reserved_width();
+		coord th = texinfo.texture.reserved_height();
+
+		mins ->resize(npoints);
+		maxes->resize(npoints);
+		for (size_t i = 0; i < npoints; ++i)
+		{
+			const Coord3& min = texinfo.point_mins[i];
+			const Coord3& max = texinfo.point_maxes[i];
+			(*mins) [i].reset(min.x / tw, min.y / th);
+			(*maxes)[i].reset(max.x / tw, max.y / th);
+		}
+	}
+
 	static void
 	draw (
 		PainterData* self, PrimitiveMode mode,
@@ -597,53 +810,102 @@ namespace Rays
 
 		Matrix texcoord_matrix(1);
 		Point texcoord_min(0, 0), texcoord_max(1, 1);
+		bool ranges = false;
 		if (texinfo)
 		{
 			setup_texcoord_variables(
 				&texcoord_matrix, &texcoord_min, &texcoord_max, self->state, *texinfo);
+
+			ranges = texinfo->point_mins && texinfo->point_maxes;
+			if (ranges)
+			{
+				setup_texcoord_ranges(
+					&self->texcoord_mins, &self->texcoord_maxes, *texinfo, npoints);
+			}
 		}
 
-		const auto& names = Shader_get_builtin_variable_names(shader);
+		const auto& locations = ShaderProgram_get_builtin_variable_locations(*program);
 		apply_uniforms(
-			*program, names, position_matrix, texcoord_matrix,
+			locations, position_matrix, texcoord_matrix,
 			texinfo ? &texinfo->texture : NULL);
 		apply_attributes(
-			self, *program, names, points, npoints, color, colors,
-			texcoords, &texcoord_min, &texcoord_max, NULL, NULL);
+			self, locations, points, npoints, color, colors,
+			texcoords, &texcoord_min, &texcoord_max,
+			ranges ? &self->texcoord_mins[0]  : NULL,
+			ranges ? &self->texcoord_maxes[0] : NULL);
 		draw_indices(self, mode, indices, nindices, npoints);
 		self->cleanup();
+	}
 
-		ShaderProgram_deactivate();
+	static void
+	count_flush (Painter::Statistics* st, FlushReason reason)
+	{
+		++st->flushes;
+		switch (reason)
+		{
+			case FLUSH_EXPLICIT:      ++st->flushes_by_explicit;      break;
+			case FLUSH_BLEND:         ++st->flushes_by_blend;         break;
+			case FLUSH_CLIP:          ++st->flushes_by_clip;          break;
+			case FLUSH_SHADER:        ++st->flushes_by_shader;        break;
+			case FLUSH_UNIFORM:       ++st->flushes_by_uniform;       break;
+			case FLUSH_TEXTURE:       ++st->flushes_by_texture;       break;
+			case FLUSH_TEXCOORD_MODE: ++st->flushes_by_texcoord_mode; break;
+			case FLUSH_TEXCOORD_WRAP: ++st->flushes_by_texcoord_wrap; break;
+			case FLUSH_TEXT:          ++st->flushes_by_text;          break;
+			case FLUSH_PRIMITIVE:     ++st->flushes_by_primitive;     break;
+			case FLUSH_CAPACITY:      ++st->flushes_by_capacity;      break;
+		}
 	}
 
 	static void
-	draw_batch (PainterData* self)
+	draw_batch (PainterData* self, FlushReason reason)
 	{
 		Batcher& batcher = self->batcher;
-		if (batcher.points.empty()) return;
+		if (
+			batcher.vertices.empty()             &&
+			batcher.float_color_vertices.empty() &&
+			batcher.shape_vertices.empty())
+		{
+			return;
+		}
 
 		const ShaderProgram* program = Shader_get_program(batcher.shader);
 		if (!program || !*program)
 			return batcher.clear_buffers();
 
-		ShaderProgram_activate(*program);
+		count_flush(&self->statistics, reason);
+
+		// the uniforms may have been changed since the vertices were batched,
+		// by the next draw or by another painter using the same shader.
+		ShaderProgram_activate(*program, batcher.uniforms.get());
 
-		const auto& names = Shader_get_builtin_variable_names(batcher.shader);
+		const auto& locations = ShaderProgram_get_builtin_variable_locations(*program);
 		Matrix identity(1);
 		apply_uniforms(
-			*program, names, identity, identity, batcher.texture ? &batcher.texture : NULL);
-		apply_attributes(
-			self, *program, names, &batcher.points[0], batcher.points.size(),
-			NULL, &batcher.colors[0],
-			&batcher.texcoords[0],
-			NULL, NULL, &batcher.texcoord_mins[0], &batcher.texcoord_maxes[0]);
-		draw_indices(
-			self, MODE_TRIANGLES,
-			&batcher.indices[0], batcher.indices.size(), batcher.points.size());
+			locations, identity, identity, batcher.texture ? &batcher.texture : NULL);
+		// the shader of the batch decides which of the vertices are used
+		if (!batcher.shape_vertices.empty())
+		{
+			apply_attributes(
+				self, locations, &batcher.shape_vertices[0], batcher.shape_vertices.size());
+		}
+		else if (!batcher.float_color_vertices.empty())
+		{
+			apply_attributes(
+				self, locations,
+				&batcher.float_color_vertices[0], batcher.float_color_vertices.size());
+		}
+		else
+		{
+			apply_attributes(
+				self, locations, &batcher.vertices[0], batcher.vertices.size());
+		}
+		draw_elements(
+			self, batcher.mode, &batcher.indices[0], batcher.indices.size());
 		self->cleanup();
 
-		ShaderProgram_deactivate();
 		batcher.clear_buffers();
+		self->count_buffer_growth();
 	}
 
 	static inline GLuint
@@ -653,6 +915,13 @@ namespace Rays
 		return p ? p->id() : 0;
 	}
 
+	static inline uint
+	get_shader_uniform_version (const Shader& shader)
+	{
+		const ShaderProgram* p = Shader_get_program(shader);
+		return p ? ShaderProgram_get_uniform_version(*p) : 0;
+	}
+
 	static void
 	ensure_state_and_flush_batch (
 		Painter* painter, const Shader& shader, const Texture& texture)
@@ -662,38 +931,49 @@ namespace Rays
 		const PainterState& s = self->state;
 		GLuint  shader_id     = get_shader_program_id(shader);
 		GLuint texture_id     = Texture_get_id(texture);
+		uint uniform_version  = get_shader_uniform_version(shader);
 
 		bool state_changed = Xot::check_and_remove_flag(
 			&self->flags, Painter::Data::UNBATCHABLE_STATE_CHANGED);
 		if (
-			!state_changed                   &&
-			b.cached_shader_id  == shader_id &&
-			b.cached_texture_id == texture_id)
+			!state_changed                             &&
+			b.cached_shader_id       == shader_id      &&
+			b.cached_texture_id      == texture_id     &&
+			b.cached_uniform_version == uniform_version)
 		{
 			return;
 		}
 
 		bool blend_changed = b.blend_mode != s.blend_mode;
 		bool clip_changed  = b.clip       != s.clip;
-		if (
-			b.count > 0 &&
-			(
-				blend_changed                          ||
-				clip_changed                           ||
-				b.cached_shader_id  != shader_id       ||
-				b.cached_texture_id != texture_id      ||
-				b.texcoord_mode     != s.texcoord_mode ||
-				b.texcoord_wrap     != s.texcoord_wrap
-			))
+		if (b.count > 0)
 		{
-			Painter_flush(painter);
+			FlushReason reason = FLUSH_EXPLICIT;
+			if (blend_changed)
+				reason = FLUSH_BLEND;
+			else if (clip_changed)
+				reason = FLUSH_CLIP;
+			else if (b.cached_shader_id       != shader_id)
+				reason = FLUSH_SHADER;
+			else if (b.cached_uniform_version != uniform_version)
+				reason = FLUSH_UNIFORM;
+			else if (b.cached_texture_id      != texture_id)
+				reason = FLUSH_TEXTURE;
+			else if (b.texcoord_mode          != s.texcoord_mode)
+				reason = FLUSH_TEXCOORD_MODE;
+			else if (b.texcoord_wrap          != s.texcoord_wrap)
+				reason = FLUSH_TEXCOORD_WRAP;
+
+			if (reason != FLUSH_EXPLICIT)
+				Painter_flush(painter, reason);
 		}
 
 		if (blend_changed) self->apply_blend_mode();
 		if (clip_changed)  self->apply_clipping();
 
-		b.cached_shader_id  = shader_id;
-		b.cached_texture_id = texture_id;
+		b.cached_shader_id       = shader_id;
+		b.cached_texture_id      = texture_id;
+		b.cached_uniform_version = uniform_version;
 		b.blend_mode        = s.blend_mode;
 		b.texcoord_mode     = s.texcoord_mode;
 		b.texcoord_wrap     = s.texcoord_wrap;
@@ -702,81 +982,237 @@ namespace Rays
 		b.texture           = texture;
 	}
 
-	static inline Vector4
-	apply_matrix (const Matrix& matrix, const Coord3& point)
+	static inline uchar
+	pack_color_value (float value)
 	{
-		return to_rays<Vector4>(to_glm(matrix) * Vec4(point.x, point.y, point.z, 1));
+		return (uchar) (std::clamp(value, 0.f, 1.f) * 255 + 0.5f);
 	}
 
-	static void
-	batch (
-		Painter* painter, PrimitiveMode mode, const Color* color,
-		const Coord3* points,  size_t npoints,
-		const uint*   indices, size_t nindices,
-		const Color*  colors,
-		const Coord3* texcoords, const TextureInfo* texinfo,
-		const Shader& shader)
+	static inline void
+	pack_color (uchar* rgba, const Color& color)
 	{
-		PainterData* self = get_data(painter);
-		Batcher& batcher  = self->batcher;
+		rgba[0] = pack_color_value(color.red);
+		rgba[1] = pack_color_value(color.green);
+		rgba[2] = pack_color_value(color.blue);
+		rgba[3] = pack_color_value(color.alpha);
+	}
 
-		Texture texture = texinfo ? texinfo->texture : INVALID_TEXTURE;
-		ensure_state_and_flush_batch(painter, shader, texture);
+	static inline void
+	set_vertex_color (PackedColor* to, const Color& color)
+	{
+		to->red   = pack_color_value(color.red);
+		to->green = pack_color_value(color.green);
+		to->blue  = pack_color_value(color.blue);
+		to->alpha = pack_color_value(color.alpha);
+	}
 
-		if (++batcher.count <= 5)
-		{
-			return draw(
-				self, mode, color, points, npoints, indices, nindices, colors,
-				texcoords, texinfo, shader, self->position_matrix);
-		}
+	static inline void
+	set_vertex_color (Color* to, const Color& color)
+	{
+		*to = color;
+	}
 
-		size_t points0 = batcher.points.size();
+	static PrimitiveMode
+	get_batch_mode (PrimitiveMode mode)
+	{
+		switch (mode)
+		{
+			case MODE_TRIANGLE_FAN: return MODE_TRIANGLES;
 
-		for (size_t i = 0; i < npoints; ++i)
-			batcher.points.push_back(apply_matrix(self->position_matrix, points[i]));
+			// GL_LINES rasterizes each segment exactly like a line strip/loop
+			// does, so the converted lines keep pixel parity with the originals.
+			case MODE_LINE_STRIP:
+			case MODE_LINE_LOOP:    return MODE_LINES;
 
-		if (indices && nindices > 0)
+			default:                return mode;
+		}
+	}
+
+	static size_t
+	count_batch_indices (PrimitiveMode mode, size_t nindices, size_t npoints)
+	{
+		switch (mode)
 		{
-			for (size_t i = 0; i < nindices; ++i)
-				batcher.indices.push_back((uint) (points0 + indices[i]));
+			case MODE_TRIANGLE_FAN: return npoints >= 3 ? (npoints - 2) * 3 : 0;
+			case MODE_LINE_STRIP:   return npoints >= 2 ? (npoints - 1) * 2 : 0;
+			case MODE_LINE_LOOP:    return npoints >= 2 ?  npoints      * 2 : 0;
+			default:                return nindices > 0 ? nindices : npoints;
 		}
-		else
+	}
+
+	static void
+	append_batch_indices (
+		std::vector<ushort>* indices, size_t base, PrimitiveMode mode,
+		const uint* src, size_t nsrc, size_t npoints)
+	{
+		assert(indices && base + npoints <= INDEX16_VERTICES_MAX);
+
+		size_t size = indices->size();
+		indices->resize(size + count_batch_indices(mode, nsrc, npoints));
+		ushort* p = &(*indices)[0] + size;
+
+		switch (mode)
 		{
-			for (size_t i = 0; i < npoints; ++i)
-				batcher.indices.push_back((uint) (points0 + i));
+			case MODE_TRIANGLE_FAN:
+				for (size_t i = 1; i + 1 < npoints; ++i)
+				{
+					*p++ = (ushort)  base;
+					*p++ = (ushort) (base + i);
+					*p++ = (ushort) (base + i + 1);
+				}
+				break;
+
+			case MODE_LINE_STRIP:
+			case MODE_LINE_LOOP:
+				for (size_t i = 0; i + 1 < npoints; ++i)
+				{
+					*p++ = (ushort) (base + i);
+					*p++ = (ushort) (base + i + 1);
+				}
+				if (mode == MODE_LINE_LOOP)
+				{
+					*p++ = (ushort) (base + npoints - 1);
+					*p++ = (ushort)  base;
+				}
+				break;
+
+			default:
+				if (src && nsrc > 0)
+				{
+					for (size_t i = 0; i < nsrc; ++i)
+						*p++ = (ushort) (base + src[i]);
+				}
+				else
+				{
+					for (size_t i = 0; i < npoints; ++i)
+						*p++ = (ushort) (base + i);
+				}
+				break;
 		}
+	}
 
-		if (colors)
-			batcher.colors.insert(batcher.colors.end(), colors, colors + npoints);
-		else if (color)
-			batcher.colors.insert(batcher.colors.end(), npoints, *color);
+	template <typename VERTEX>
+	static void
+	append_batch_vertices (
+		std::vector<VERTEX>* buffer, PainterData* self,
+		PrimitiveMode mode, const Color* color,
+		const Coord3* points,  size_t npoints,
+		const uint*   indices, size_t nindices,
+		const Color*  colors,
+		const Coord3* texcoords, const TextureInfo* texinfo)
+	{
+		assert(buffer && self);
+
+		const Texture& texture = texinfo ? texinfo->texture : INVALID_TEXTURE;
+
+		size_t points0 = buffer->size();
+		buffer->resize(points0 + npoints);
+		VERTEX* vertices = &(*buffer)[points0];
 
+		append_batch_indices(
+			&self->batcher.indices, points0, mode, indices, nindices, npoints);
+
+		Matrix texcoord_matrix(1);
+		Point texcoord_min(0, 0), texcoord_max(1, 1);
 		if (texture)
 		{
-			Matrix matrix(1);
-			Point min(0, 0), max(1, 1);
-			setup_texcoord_variables(&matrix, &min, &max, self->state, *texinfo);
+			setup_texcoord_variables(
+				&texcoord_matrix, &texcoord_min, &texcoord_max, self->state, *texinfo);
+		}
+
+		decltype(VERTEX::color) vertex_color;
+		set_vertex_color(&vertex_color, !colors && color ? *color : Color(1, 1, 1, 1));
+
+		Matrix_transform_points(
+			&vertices[0].position, sizeof(VERTEX),
+			self->position_matrix, points, npoints);
+		Matrix_transform_points(
+			&vertices[0].texcoord, sizeof(VERTEX),
+			texcoord_matrix, texcoords ? texcoords : points, npoints);
+
+		for (size_t i = 0; i < npoints; ++i)
+		{
+			VERTEX& v = vertices[i];
+
+			if (colors) set_vertex_color(&vertex_color, colors[i]);
+			v.color = vertex_color;
+
+			v.texcoord_min.reset(texcoord_min.x, texcoord_min.y);
+			v.texcoord_max.reset(texcoord_max.x, texcoord_max.y);
+		}
 
-			const Coord3* src = texcoords ? texcoords : points;
+		if (texture && texinfo->point_mins && texinfo->point_maxes)
+		{
+			coord tw = texture.reserved_width();
+			coord th = texture.reserved_height();
 			for (size_t i = 0; i < npoints; ++i)
-				batcher.texcoords.push_back(apply_matrix(matrix, src[i]));
+			{
+				const Coord3& min = texinfo->point_mins[i];
+				const Coord3& max = texinfo->point_maxes[i];
+				vertices[i].texcoord_min.reset(min.x / tw, min.y / th);
+				vertices[i].texcoord_max.reset(max.x / tw, max.y / th);
+			}
+		}
+	}
 
-			batcher.texcoord_mins .insert(batcher.texcoord_mins.end(),  npoints, min);
-			batcher.texcoord_maxes.insert(batcher.texcoord_maxes.end(), npoints, max);
+	static void
+	batch (
+		Painter* painter, PrimitiveMode mode, const Color* color,
+		const Coord3* points,  size_t npoints,
+		const uint*   indices, size_t nindices,
+		const Color*  colors,
+		const Coord3* texcoords, const TextureInfo* texinfo,
+		const Shader& shader)
+	{
+		PainterData* self = get_data(painter);
+		Batcher& batcher  = self->batcher;
+
+		Texture texture = texinfo ? texinfo->texture : INVALID_TEXTURE;
+		ensure_state_and_flush_batch(painter, shader, texture);
+
+		PrimitiveMode batch_mode = get_batch_mode(mode);
+		if (batcher.mode != batch_mode)
+		{
+			Painter_flush(painter, FLUSH_PRIMITIVE);
+			batcher.mode = batch_mode;
+		}
+
+		size_t nbatched = batcher.vertices.size() + batcher.float_color_vertices.size();
+		if (nbatched + npoints > INDEX16_VERTICES_MAX)
+			Painter_flush(painter, FLUSH_CAPACITY);
+
+		if (++batcher.count <= 5 || npoints > INDEX16_VERTICES_MAX)
+		{
+			++self->statistics.immediate_draws;
+			return draw(
+				self, mode, color, points, npoints, indices, nindices, colors,
+				texcoords, texinfo, shader, self->position_matrix);
+		}
+
+		if (count_batch_indices(mode, nindices, npoints) == 0)
+			return;
+
+		++self->statistics.batched_draws;
+		batcher.record_uniforms();
+
+		if (self->state.shader)
+		{
+			append_batch_vertices(
+				&batcher.float_color_vertices, self, mode, color, points, npoints,
+				indices, nindices, colors, texcoords, texinfo);
 		}
 		else
 		{
-			const Coord3* src = texcoords ? texcoords : points;
-			batcher.texcoords     .insert(batcher.texcoords.end(),      src, src + npoints);
-			batcher.texcoord_mins .insert(batcher.texcoord_mins.end(),  npoints, Point(0, 0));
-			batcher.texcoord_maxes.insert(batcher.texcoord_maxes.end(), npoints, Point(1, 1));
+			append_batch_vertices(
+				&batcher.vertices, self, mode, color, points, npoints,
+				indices, nindices, colors, texcoords, texinfo);
 		}
 	}
 
 	void
-	Painter_flush (Painter* painter)
+	Painter_flush (Painter* painter, FlushReason reason)
 	{
-		draw_batch(get_data(painter));
+		draw_batch(get_data(painter), reason);
 	}
 
 	static const TextureInfo*
@@ -806,21 +1242,6 @@ namespace Rays
 			:	&Shader_get_default_shader_for_shape();
 	}
 
-	static bool
-	setup_triangle_fan_indices (auto* indices, size_t npoints)
-	{
-		if (npoints < 3) return false;
-
-		indices->reserve((npoints - 2) * 3);
-		for (size_t i = 1; i + 1 < npoints; ++i)
-		{
-			indices->push_back(0);
-			indices->push_back((uint) i);
-			indices->push_back((uint) (i + 1));
-		}
-		return true;
-	}
-
 	void
 	Painter_draw (
 		Painter* painter, PrimitiveMode mode, const Color* color,
@@ -841,38 +1262,370 @@ namespace Rays
 		if (!self->is_painting())
 			invalid_state_error(__FILE__, __LINE__, "'painting' should be true.");
 
+		if (self->picture)
+		{
+			return Picture_add_draw(
+				&self->picture, self->state, self->position_matrix,
+				mode, color, points, npoints, indices, nindices,
+				colors, texcoords, texinfo, shader);
+		}
+
 		std::unique_ptr<TextureInfo> ptexinfo;
 		texinfo = setup_texinfo(self, texinfo, &ptexinfo);
 		shader  = setup_shader(self, shader, texinfo);
 
+		++self->statistics.draws;
+
 		bool batchable =
 			painter->has_flag(Painter::FLAG_BATCHING) &&
 			!Painter::debug() &&
-			!self->state.shader;
-		if (batchable && mode == MODE_TRIANGLES)
+			(!self->state.shader || Shader_is_batchable(self->state.shader));
+		bool no_indices = !indices || nindices == 0;
+		if (
+			batchable &&
+			(
+				mode == MODE_TRIANGLES || mode == MODE_LINES ||
+				(
+					no_indices &&
+					(
+						mode == MODE_TRIANGLE_FAN ||
+						mode == MODE_LINE_STRIP   ||
+						mode == MODE_LINE_LOOP
+					)
+				)
+			))
 		{
 			batch(
 				painter, mode, color, points, npoints, indices, nindices,
 				colors, texcoords, texinfo, *shader);
 		}
-		else if (batchable && mode == MODE_TRIANGLE_FAN && (!indices || nindices == 0))
-		{
-			auto& fan_indices = self->triangle_fan_indices_buffer;
-			fan_indices.clear();
-			if (!setup_triangle_fan_indices(&fan_indices, npoints))
-				return;
-			batch(
-				painter, MODE_TRIANGLES, color, points, npoints, &fan_indices[0], fan_indices.size(),
-				colors, texcoords, texinfo, *shader);
-		}
 		else
 		{
 			ensure_state_and_flush_batch(
 				painter, *shader, texinfo ? texinfo->texture : INVALID_TEXTURE);
+
+			// pending batched primitives have to be drawn before this one.
+			Painter_flush(painter, FLUSH_PRIMITIVE);
+
+			++self->statistics.immediate_draws;
 			draw(
 				self, mode, color, points, npoints, indices, nindices,
 				colors, texcoords, texinfo, *shader, self->position_matrix);
 		}
+
+		self->count_buffer_growth();
+	}
+
+	void
+	Painter_draw_recorded (
+		Painter* painter, PrimitiveMode mode,
+		const Coord3* points,  size_t npoints,
+		const uint*   indices, size_t nindices,
+		const Color*  colors,
+		const Coord3* texcoords,
+		const TextureInfo* texinfo,
+		const Shader* shader)
+	{
+		assert(points && npoints > 0 && colors && texcoords);
+
+		PainterData* self = get_data(painter);
+		assert(self->is_painting() && !self->picture);
+
+		shader = setup_shader(self, shader, texinfo);
+
+		ensure_state_and_flush_batch(
+			painter, *shader, texinfo ? texinfo->texture : INVALID_TEXTURE);
+		Painter_flush(painter, FLUSH_PRIMITIVE);
+
+		++self->statistics.draws;
+		++self->statistics.immediate_draws;
+		draw(
+			self, mode, NULL, points, npoints, indices, nindices,
+			colors, texcoords, texinfo, *shader, self->position_matrix);
+
+		self->count_buffer_growth();
+	}
+
+	// Returns the number of pixels per unit of the coordinates that the
+	// current matrix transforms.
+	static coord
+	get_pixel_scale (const PainterData* self)
+	{
+		const Matrix& m = self->position_matrix;
+		coord w         = self->viewport.width  * self->pixel_density / 2;
+		coord h         = self->viewport.height * self->pixel_density / 2;
+		coord det       =
+			m.at(0, 0) * w * m.at(1, 1) * h -
+			m.at(0, 1) * w * m.at(1, 0) * h;
+		return sqrt(fabs(det));
+	}
+
+	static void
+	begin_shape_batch (Painter* painter, const Shader& shader)
+	{
+		PainterData* self = get_data(painter);
+		Batcher& batcher  = self->batcher;
+
+		ensure_state_and_flush_batch(painter, shader, INVALID_TEXTURE);
+
+		if (batcher.mode != MODE_TRIANGLES)
+		{
+			Painter_flush(painter, FLUSH_PRIMITIVE);
+			batcher.mode = MODE_TRIANGLES;
+		}
+
+		++self->statistics.draws;
+		++self->statistics.batched_draws;
+	}
+
+	static ShapeVertex*
+	append_shape_vertices (
+		Painter* painter, const ushort* indices, size_t nindices, size_t nvertices)
+	{
+		assert(indices && nvertices <= INDEX16_VERTICES_MAX);
+
+		Batcher& batcher = get_data(painter)->batcher;
+
+		if (batcher.shape_vertices.size() + nvertices > INDEX16_VERTICES_MAX)
+			Painter_flush(painter, FLUSH_CAPACITY);
+
+		++batcher.count;
+		batcher.record_uniforms();
+
+		size_t base = batcher.shape_vertices.size();
+		for (size_t i = 0; i < nindices; ++i)
+			batcher.indices.push_back((ushort) (base + indices[i]));
+
+		batcher.shape_vertices.resize(base + nvertices);
+		return &batcher.shape_vertices[base];
+	}
+
+	static void
+	end_shape_batch (Painter* painter)
+	{
+		if (!painter->has_flag(Painter::FLAG_BATCHING) || Painter::debug())
+			Painter_flush(painter, FLUSH_PRIMITIVE);
+	}
+
+	void
+	Painter_draw_sdf_shape (
+		Painter* painter, const Color& color, const SDFShape& shape)
+	{
+		PainterData* self = get_data(painter);
+
+		if (!self->is_painting())
+			invalid_state_error(__FILE__, __LINE__, "'painting' should be true.");
+
+		const Bounds& frame = shape.frame;
+		if (frame.width <= 0 || frame.height <= 0)
+			argument_error(__FILE__, __LINE__);
+
+		coord scale = get_pixel_scale(self);
+		if (scale <= 0) return;
+
+		coord dist_min = shape.distance_min * scale;
+		coord dist_max = shape.distance_max * scale;
+		if (dist_max - dist_min < 1)
+		{
+			coord center = (dist_min + dist_max) / 2;
+			dist_min     = center - 0.5;
+			dist_max     = center + 0.5;
+		}
+
+		// the quad covers the strokes outside of the shape and the pixels
+		// antialiased along the outline
+		coord margin = (std::max(dist_max, (coord) 0) + 1) / scale;
+		coord cx     = frame.x + frame.width  / 2;
+		coord cy     = frame.y + frame.height / 2;
+		coord hw     = frame.width  / 2 + margin;
+		coord hh     = frame.height / 2 + margin;
+		const Point points[] = {
+			Point(cx - hw, cy - hh),
+			Point(cx - hw, cy + hh),
+			Point(cx + hw, cy + hh),
+			Point(cx + hw, cy - hh),
+		};
+
+		begin_shape_batch(painter, Shader_get_shader_for_shape_sdf());
+
+		static const ushort INDICES[] = {0, 1, 2, 0, 2, 3};
+		ShapeVertex* vertices = append_shape_vertices(painter, INDICES, 6, 4);
+
+		Matrix_transform_points(
+			&vertices[0].position, sizeof(ShapeVertex),
+			self->position_matrix, points, 4);
+
+		uchar rgba[4];
+		pack_color(rgba, color);
+
+		bool rect      = shape.type == SDFShape::RECT;
+		bool full      = rect || shape.radian_from == shape.radian_to;
+		coord radius_x = frame.width  / 2 * scale;
+		coord radius_y = frame.height / 2 * scale;
+		for (size_t i = 0; i < 4; ++i)
+		{
+			ShapeVertex& v = vertices[i];
+			v.set_color(rgba);
+
+			v.texcoord.reset(
+				(points[i].x - cx) * scale,
+				(points[i].y - cy) * scale,
+				full ? 0        : shape.radian_from,
+				full ? M_PI * 2 : shape.radian_to);
+			v.texcoord_min.reset(radius_x, radius_y, dist_min);
+			if (rect)
+				v.texcoord_max.reset(-1, shape.round * scale, dist_max);
+			else
+			{
+				v.texcoord_max.reset(
+					shape.hole_size.x / 2 * scale,
+					shape.hole_size.y / 2 * scale,
+					dist_max);
+			}
+		}
+
+		end_shape_batch(painter);
+	}
+
+	bool
+	Painter_can_extrude_stroke (Painter* painter)
+	{
+		PainterData* self         = get_data(painter);
+		const PainterState& state = self->state;
+		const Matrix& m           = self->position_matrix;
+
+		// the pieces are extruded in 2D, so no perspective
+		return
+			painter->has_flag(Painter::FLAG_GPU_STROKES) &&
+			!self->picture && !state.shader && !state.texture &&
+			m.at(3, 0) == 0 && m.at(3, 1) == 0;
+	}
+
+	enum StrokePiece
+	{
+
+		STROKE_SEGMENT = 0,
+
+		STROKE_JOIN,
+
+		STROKE_ROUND
+
+	};// StrokePiece
+
+	static void
+	set_stroke_vertex (
+		ShapeVertex* vertex, const uchar* rgba, StrokePiece piece,
+		const Coord4& anchor, const Coord4& prev, const Coord4& next,
+		coord param_x, coord param_y, coord width, const Coord2& scale)
+	{
+		vertex->position = anchor;
+		vertex->set_color(rgba);
+		vertex->texcoord    .reset(prev.x, prev.y, next.x, next.y);
+		vertex->texcoord_min.reset(param_x, param_y, width);
+		vertex->texcoord_max.reset(scale.x, scale.y, piece);
+	}
+
+	void
+	Painter_extrude_stroke (
+		Painter* painter, const Color& color,
+		const Point* points, size_t npoints, bool loop)
+	{
+		PainterData* self = get_data(painter);
+
+		if (!self->is_painting())
+			invalid_state_error(__FILE__, __LINE__, "'painting' should be true.");
+
+		if (!points)
+			argument_error(__FILE__, __LINE__);
+
+		const PainterState& state = self->state;
+
+		coord width = state.stroke_width / 2 * get_pixel_scale(self);
+		if (width <= 0 || npoints < 2) return;
+
+		std::vector<Coord4>& centers = self->stroke_points;
+		centers.resize(npoints);
+		Matrix_transform_points(
+			&centers[0], sizeof(Coord4), self->position_matrix, points, npoints);
+
+		// segments without length have no direction to extrude
+		auto same = [](const Coord4& a, const Coord4& b) {
+			return a.x == b.x && a.y == b.y;
+		};
+		centers.erase(std::unique(centers.begin(), centers.end(), same), centers.end());
+		if (loop && centers.size() >= 2 && same(centers.front(), centers.back()))
+			centers.pop_back();
+
+		size_t size = centers.size();
+		if (size < 2) return;
+
+		Coord2 scale;
+		scale.reset(
+			self->viewport.width  * self->pixel_density / 2,
+			self->viewport.height * self->pixel_density / 2);
+
+		uchar rgba[4];
+		pack_color(rgba, color);
+
+		begin_shape_batch(painter, Shader_get_shader_for_stroke());
+
+		static const ushort QUAD[] = {0, 1, 2, 0, 2, 3};
+		static const ushort JOIN[] = {0, 1, 2, 1, 3, 4, 1, 4, 2};
+
+		auto add_round = [&](const Coord4& center)
+		{
+			ShapeVertex* v = append_shape_vertices(painter, QUAD, 6, 4);
+			set_stroke_vertex(v + 0, rgba, STROKE_ROUND, center, center, center, -1, -1, width, scale);
+			set_stroke_vertex(v + 1, rgba, STROKE_ROUND, center, center, center, -1, +1, width, scale);
+			set_stroke_vertex(v + 2, rgba, STROKE_ROUND, center, center, center, +1, +1, width, scale);
+			set_stroke_vertex(v + 3, rgba, STROKE_ROUND, center, center, center, +1, -1, width, scale);
+		};
+
+		size_t nsegments = loop ? size : size - 1;
+		bool square      = !loop && state.stroke_cap == CAP_SQUARE;
+		for (size_t i = 0; i < nsegments; ++i)
+		{
+			const Coord4& a = centers[i];
+			const Coord4& b = centers[(i + 1) % size];
+			coord along_a   = square && i == 0             ? -1 : 0;
+			coord along_b   = square && i == nsegments - 1 ? +1 : 0;
+
+			ShapeVertex* v = append_shape_vertices(painter, QUAD, 6, 4);
+			set_stroke_vertex(v + 0, rgba, STROKE_SEGMENT, a, a, b, +1, along_a, width, scale);
+			set_stroke_vertex(v + 1, rgba, STROKE_SEGMENT, a, a, b, -1, along_a, width, scale);
+			set_stroke_vertex(v + 2, rgba, STROKE_SEGMENT, b, a, b, -1, along_b, width, scale);
+			set_stroke_vertex(v + 3, rgba, STROKE_SEGMENT, b, a, b, +1, along_b, width, scale);
+		}
+
+		// square joins have no miter limit, which the shader tells by zero
+		coord limit = state.stroke_join == JOIN_SQUARE ? 0 : state.miter_limit;
+		for (size_t i = loop ? 0 : 1; i < (loop ? size : size - 1); ++i)
+		{
+			const Coord4& p = centers[i];
+			if (state.stroke_join == JOIN_ROUND)
+			{
+				add_round(p);
+				continue;
+			}
+
+			const Coord4& prev = centers[(i + size - 1) % size];
+			const Coord4& next = centers[(i + 1)        % size];
+
+			ShapeVertex* v = append_shape_vertices(painter, JOIN, 9, 5);
+			for (int corner = 0; corner < 5; ++corner)
+			{
+				set_stroke_vertex(
+					v + corner, rgba, STROKE_JOIN, p, prev, next, corner, limit, width, scale);
+			}
+		}
+
+		if (!loop && state.stroke_cap == CAP_ROUND)
+		{
+			add_round(centers.front());
+			add_round(centers.back());
+		}
+
+		end_shape_batch(painter);
 	}
 
 	static inline void
@@ -909,22 +1662,17 @@ namespace Rays
 #endif
 	}
 
-	void
-	Painter_draw_text_line (
-		Painter* painter, const Font& font,
-		const char* line, coord x, coord y,
-		coord width, coord height)
+	static void
+	draw_text_line_with_image (
+		Painter* painter, const Font& font, const RawFont& rawfont,
+		const char* line, coord x, coord y)
 	{
-		assert(painter && font && line && *line != '\0');
-
-		// exclude text rendering from batching for now;
 		// text_image is shared and gets overwritten by next text draw
-		Painter_flush(painter);
+		Painter_flush(painter, FLUSH_TEXT);
 
 		Painter::Data* self = painter->self.get();
 
 		float density          = self->pixel_density;
-		const RawFont& rawfont = Font_get_raw(font, density);
 		coord str_w            = rawfont.get_width(line);
 		coord str_h            = rawfont.get_height();
 		int tex_w              = ceil(str_w);
@@ -950,8 +1698,6 @@ namespace Rays
 
 		str_w /= density;
 		str_h /= density;
-		if (width  == 0) width  = str_w;
-		if (height == 0) height = str_h;
 
 		Painter_draw_image(
 			painter, self->text_image,
@@ -962,6 +1708,60 @@ namespace Rays
 		debug_draw_text_line(painter, font, x, y, str_w / density, str_h / density);
 	}
 
+	void
+	Painter_draw_text_line (
+		Painter* painter, const Font& font,
+		const char* line, coord x, coord y,
+		coord width, coord height)
+	{
+		assert(painter && font && line && *line != '\0');
+
+		PainterData* self = get_data(painter);
+
+		// texts are rasterized when the picture is drawn
+		if (self->picture)
+		{
+			return Picture_add_text_line(
+				&self->picture, self->state, self->position_matrix,
+				font, line, x, y, width, height);
+		}
+
+		float density          = self->pixel_density;
+		const RawFont& rawfont = Font_get_raw(font, density);
+
+		// glyphs from the atlas are placed by their own advances without the
+		// kerning and shaping that the whole line gets, so it is opt-in.
+		if (!painter->has_flag(Painter::FLAG_GLYPH_ATLAS))
+			return draw_text_line_with_image(painter, font, rawfont, line, x, y);
+
+		Image atlas;
+		auto& glyphs = self->glyphs;
+		if (!GlyphAtlas_get_glyphs(
+			&glyphs, &atlas, rawfont, font.smooth(), line, density))
+		{
+			return draw_text_line_with_image(painter, font, rawfont, line, x, y);
+		}
+
+		// each glyph is a textured quad from the shared atlas, so that
+		// consecutive text draws end up in the same batch.
+		const Shader& shader = Shader_get_shader_for_text();
+		coord pen_x          = x;
+		for (const auto& glyph : glyphs)
+		{
+			if (glyph.visible())
+			{
+				coord w = glyph.width  / density;
+				coord h = glyph.height / density;
+				Painter_draw_image(
+					painter, atlas,
+					glyph.x / density, glyph.y / density, w, h,
+					pen_x, y, w, h,
+					&shader);
+			}
+			pen_x += glyph.advance / density;
+		}
+	}
+
 
 	Painter::Painter ()
 	:	self(new PainterData())
@@ -987,6 +1787,21 @@ namespace Rays
 		canvas(0, 0, image.width(), image.height(), image.pixel_density());
 	}
 
+	void
+	Painter::bind (const Picture& picture)
+	{
+		if (!picture)
+			argument_error(__FILE__, __LINE__, "invalid picture.");
+
+		if (self->is_painting())
+			invalid_state_error(__FILE__, __LINE__, "painting flag should be false.");
+
+		unbind();
+
+		self->picture = picture;
+		canvas(0, 0, picture.width(), picture.height());
+	}
+
 	void
 	Painter::unbind ()
 	{
@@ -994,6 +1809,19 @@ namespace Rays
 			invalid_state_error(__FILE__, __LINE__, "painting flag should be true.");
 
 		get_data(this)->frame_buffer = FrameBuffer();
+		self->picture                = Picture();
+	}
+
+	static void
+	begin_recording (PainterData* self)
+	{
+		// the points are recorded in the coordinates of the canvas, so that
+		// painters drawing the picture can transform them by their matrices.
+		self->statistics = Painter::Statistics();
+		self->position_matrix.reset(1);
+
+		Xot::remove_flag(&self->flags, Painter::Data::UNBATCHABLE_STATE_CHANGED);
+		Xot::   add_flag(&self->flags, Painter::Data::PAINTING);
 	}
 
 	void
@@ -1004,7 +1832,12 @@ namespace Rays
 		if (self->is_painting())
 			invalid_state_error(__FILE__, __LINE__, "painting flag should be false.");
 
-		self->opengl_state.push();
+		if (self->picture)
+			return begin_recording(self);
+
+		OpenGLState_begin();
+		self->opengl_state = OpenGLState_get();
+		self->statistics   = Painter::Statistics();
 
 		FrameBuffer& fb = self->frame_buffer;
 		if (fb)
@@ -1017,10 +1850,9 @@ namespace Rays
 
 		const Bounds& vp = self->viewport;
 		float density    = self->pixel_density;
-		glViewport(
+		OpenGLState_viewport(
 			(int) (vp.x      * density), (int) (vp.y      * density),
 			(int) (vp.width  * density), (int) (vp.height * density));
-		OpenGL_check_error(__FILE__, __LINE__);
 
 		coord x1 = vp.x, x2 = vp.x + vp.width;
 		coord y1 = vp.y, y2 = vp.y + vp.height;
@@ -1039,11 +1871,10 @@ namespace Rays
 
 		//glEnable(GL_CULL_FACE);
 
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LEQUAL);
-		OpenGL_check_error(__FILE__, __LINE__);
+		OpenGLState_enable(GL_DEPTH_TEST);
+		OpenGLState_depth_func(GL_LEQUAL);
 
-		glEnable(GL_BLEND);
+		OpenGLState_enable(GL_BLEND);
 		self->apply_blend_mode();
 		self->apply_clipping();
 
@@ -1069,30 +1900,78 @@ namespace Rays
 		if (!self->position_matrix_stack.empty())
 			invalid_state_error(__FILE__, __LINE__, "position matrix stack is not empty.");
 
+		if (self->picture)
+		{
+			Xot::remove_flag(&self->flags, Painter::Data::PAINTING);
+			return;
+		}
+
 		Painter_flush(this);
 
 		Xot::remove_flag(&self->flags, Painter::Data::PAINTING);
-		self->opengl_state.pop();
-		self->default_indices.clear();
-
-		glFinish();
+		self->vertex_buffer.unbind();
+		self->index_buffer.unbind();
+		ShaderProgram_deactivate();
+		OpenGLState_restore(self->opengl_state);
 
 		if (self->frame_buffer)
+		{
+			// readers of the texture wait on its fence only when they need
+			// the pixels, so offscreen painting does not stall the CPU here.
+			Texture& tex = self->frame_buffer.texture();
+			if (tex)
+			{
+				tex.set_modified();
+				Texture_set_fence(&tex);
+			}
+
 			FrameBuffer_unbind();
+		}
+
+		OpenGLState_end();
 
 		self->batcher.cleanup();
 	}
 
+	static void
+	clear_picture (Painter* painter)
+	{
+		PainterData* self = get_data(painter);
+
+		// the background covers everything recorded so far, and replaces
+		// the pixels under the picture like glClear() does.
+		self->picture.clear();
+
+		PainterState state = self->state;
+		state.blend_mode   = BLEND_REPLACE;
+		state.texture      = Image();
+		state.shader       = Shader();
+
+		const Bounds& vp = self->viewport;
+		Point points[4];
+		points[0].reset(vp.x,            vp.y);
+		points[1].reset(vp.x,            vp.y + vp.height);
+		points[2].reset(vp.x + vp.width, vp.y + vp.height);
+		points[3].reset(vp.x + vp.width, vp.y);
+
+		Picture_add_draw(
+			&self->picture, state, Matrix(1), MODE_TRIANGLE_FAN,
+			&state.background, points, 4, NULL, 0, NULL, NULL, NULL, NULL);
+	}
+
 	void
 	Painter::clear ()
 	{
 		if (!self->is_painting())
 			invalid_state_error(__FILE__, __LINE__, "painting flag should be true.");
 
+		if (self->picture)
+			return clear_picture(this);
+
 		Painter_flush(this);
 
 		const Color& c = self->state.background;
-		glClearColor(c.red, c.green, c.blue, c.alpha);
+		OpenGLState_clear_color(c.red, c.green, c.blue, c.alpha);
 		glClear(GL_COLOR_BUFFER_BIT);
 		OpenGL_check_error(__FILE__, __LINE__);
 	}
@@ -3,6 +3,7 @@
 
 #include <SDL.h>
 #include "../opengl.h"
+#include "../opengl_state.h"
 #include "rays/rays.h"
 #include "rays/exception.h"
 
@@ -87,6 +88,13 @@ namespace Rays
 	void
 	Renderer_fin ()
 	{
+		OpenGLState_fin();
+	}
+
+	Context
+	Renderer_get_current_context ()
+	{
+		return (Context) SDL_GL_GetCurrentContext();
 	}
 
 
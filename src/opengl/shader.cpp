@@ -38,6 +38,8 @@ namespace Rays
 
 		ShaderEnv env;
 
+		bool batchable = false;
+
 		Data (
 			const char* fragment_shader_source,
 			const char*   vertex_shader_source,
@@ -50,6 +52,8 @@ namespace Rays
 				make_vertex_shader_source(vertex_shader_source),
 				ShaderSource(GL_FRAGMENT_SHADER, fragment_shader_source),
 				env));
+
+			batchable = ShaderEnv_get_flags(env) & ShaderEnv::BATCHABLE;
 		}
 
 		ShaderSource make_vertex_shader_source (const char* source)
@@ -145,6 +149,157 @@ namespace Rays
 			"}\n");
 	}
 
+	static Shader
+	make_shader_for_shape_sdf ()
+	{
+		// texcoord.xy:     position from the center of the shape in pixels
+		// texcoord.zw:     radian range of an arc
+		// texcoord_min.xy: half size of the rect or radius of the ellipse
+		// texcoord_max.xy: radius of the hole, or (-1, corner round) for rects
+		// texcoord_min.z and texcoord_max.z: range of the distance to draw
+		const ShaderBuiltinVariableNames& names =
+			ShaderEnv_get_builtin_variable_names(DEFAULT_ENV);
+		return Shader(
+			"varying vec4 " + V_TEXCOORD + ";\n"
+			"varying vec3 " + V_TEXCOORD_MIN + ";\n"
+			"varying vec3 " + V_TEXCOORD_MAX + ";\n"
+			"varying vec4 " + V_COLOR + ";\n"
+			"float _rays_rect (vec2 p, vec2 size, float corner)\n"
+			"{\n"
+			"  vec2 q = abs(p) - size + corner;\n"
+			"  float inside = min(max(q.x, q.y), 0.0);\n"
+			"  return corner > 0.0\n"
+			"    ? length(max(q, 0.0)) + inside - corner\n"
+			"    : max(q.x, q.y);\n"
+			"}\n"
+			"float _rays_ellipse (vec2 p, vec2 radius)\n"
+			"{\n"
+			"  float k = length(p / radius);\n"
+			"  float g = length(p / (radius * radius));\n"
+			"  return g > 0.0 ? (k - 1.0) * k / g : -min(radius.x, radius.y);\n"
+			"}\n"
+			"float _rays_arc (vec2 p, vec2 radius, float from, float to)\n"
+			"{\n"
+			"  if (to - from >= 6.283) return -1.0e6;\n"
+			"  vec2 a    = normalize(radius * vec2(cos(from), sin(from)));\n"
+			"  vec2 b    = normalize(radius * vec2(cos(to),   sin(to)));\n"
+			"  float da  = a.y * p.x - a.x * p.y;\n"
+			"  float db  = b.x * p.y - b.y * p.x;\n"
+			"  return to - from <= 3.14159265 ? max(da, db) : min(da, db);\n"
+			"}\n"
+			"void main ()\n"
+			"{\n"
+			"  vec2 _rays_p     = " + V_TEXCOORD + ".xy;\n"
+			"  vec3 _rays_min   = " + V_TEXCOORD_MIN + ";\n"
+			"  vec3 _rays_max   = " + V_TEXCOORD_MAX + ";\n"
+			"  float _rays_dist;\n"
+			"  if (_rays_max.x < 0.0)\n"
+			"    _rays_dist = _rays_rect(_rays_p, _rays_min.xy, _rays_max.y);\n"
+			"  else\n"
+			"  {\n"
+			"    _rays_dist = _rays_ellipse(_rays_p, _rays_min.xy);\n"
+			"    if (_rays_max.x > 0.0 && _rays_max.y > 0.0)\n"
+			"      _rays_dist = max(_rays_dist, -_rays_ellipse(_rays_p, _rays_max.xy));\n"
+			"    _rays_dist = max(_rays_dist, _rays_arc(\n"
+			"      vec2(_rays_p.x, -_rays_p.y), _rays_min.xy,\n"
+			"      " + V_TEXCOORD + ".z, " + V_TEXCOORD + ".w));\n"
+			"  }\n"
+			"  float _rays_alpha =\n"
+			"    clamp(0.5 - (_rays_dist - _rays_max.z), 0.0, 1.0) *\n"
+			"    clamp(0.5 + (_rays_dist - _rays_min.z), 0.0, 1.0);\n"
+			"  if (_rays_alpha <= 0.0) discard;\n"
+			"  gl_FragColor = " + V_COLOR + " * vec4(1.0, 1.0, 1.0, _rays_alpha);\n"
+			"}\n");
+	}
+
+	static Shader
+	make_shader_for_stroke ()
+	{
+		// position:          anchor point of the vertex in clip coordinates
+		// texcoord.xy, zw:   points before and after the anchor
+		// texcoord_min.xy:   parameters for each kind of the pieces
+		// texcoord_min.z:    half of the stroke width in pixels
+		// texcoord_max.xy:   pixels per unit of clip coordinates
+		// texcoord_max.z:    kind of the piece; 0 = segment, 1 = join, 2 = round
+		const ShaderBuiltinVariableNames& names =
+			ShaderEnv_get_builtin_variable_names(DEFAULT_ENV);
+		String vertex_shader_source =
+			"attribute vec4 " + A_POSITION + ";\n"
+			"attribute vec4 " + A_TEXCOORD + ";\n"
+			"attribute vec3 " + A_TEXCOORD_MIN + ";\n"
+			"attribute vec3 " + A_TEXCOORD_MAX + ";\n"
+			"attribute vec4 " + A_COLOR + ";\n"
+			"varying vec4 "   + V_TEXCOORD + ";\n"
+			"varying vec4 "   + V_COLOR + ";\n"
+			"vec2 _rays_normal (vec2 dir)\n"
+			"{\n"
+			"  return vec2(-dir.y, dir.x);\n"
+			"}\n"
+			"vec2 _rays_join (vec2 p, vec2 prev, vec2 next, vec2 param, float width)\n"
+			"{\n"
+			"  vec2 d1     = normalize(p - prev);\n"
+			"  vec2 d2     = normalize(next - p);\n"
+			"  float cross = d1.x * d2.y - d1.y * d2.x;\n"
+			"  vec2 n1     = _rays_normal(d1) * (cross > 0.0 ? -width : width);\n"
+			"  vec2 n2     = _rays_normal(d2) * (cross > 0.0 ? -width : width);\n"
+			"  if (param.x < 0.5) return vec2(0.0);\n"
+			"  if (param.x < 1.5) return n1;\n"
+			"  if (param.x < 2.5) return n2;\n"
+			// square join
+			"  if (param.y <= 0.0)\n"
+			"  {\n"
+			"    float t = tan(acos(clamp(dot(d1, d2), -1.0, 1.0)) / 4.0) * width;\n"
+			"    return param.x < 3.5 ? n1 + d1 * t : n2 - d2 * t;\n"
+			"  }\n"
+			// miter join, or bevel over the limit
+			"  vec2 m = n1 + n2;\n"
+			"  float k = dot(m, m) > 0.0 ? dot(normalize(m), n1) / width : 0.0;\n"
+			"  return k * param.y > 1.0 ? normalize(m) * (width / k) : n1;\n"
+			"}\n"
+			"void main ()\n"
+			"{\n"
+			"  vec2 _rays_scale  = " + A_TEXCOORD_MAX + ".xy;\n"
+			"  float _rays_kind  = " + A_TEXCOORD_MAX + ".z;\n"
+			"  vec3 _rays_param  = " + A_TEXCOORD_MIN + ";\n"
+			"  vec2 _rays_p      = " + A_POSITION + ".xy * _rays_scale;\n"
+			"  vec2 _rays_prev   = " + A_TEXCOORD + ".xy * _rays_scale;\n"
+			"  vec2 _rays_next   = " + A_TEXCOORD + ".zw * _rays_scale;\n"
+			"  vec2 _rays_offset = vec2(0.0);\n"
+			"  vec2 _rays_corner = vec2(0.0);\n"
+			"  if (_rays_kind < 0.5)\n"
+			"  {\n"
+			"    vec2 _rays_dir = normalize(_rays_next - _rays_prev);\n"
+			"    _rays_offset   = (\n"
+			"      _rays_normal(_rays_dir) * _rays_param.x +\n"
+			"      _rays_dir               * _rays_param.y) * _rays_param.z;\n"
+			"  }\n"
+			"  else if (_rays_kind < 1.5)\n"
+			"  {\n"
+			"    _rays_offset = _rays_join(\n"
+			"      _rays_p, _rays_prev, _rays_next, _rays_param.xy, _rays_param.z);\n"
+			"  }\n"
+			"  else\n"
+			"  {\n"
+			"    _rays_corner = _rays_param.xy;\n"
+			"    _rays_offset = _rays_corner * _rays_param.z;\n"
+			"  }\n"
+			"  " + V_TEXCOORD + " = vec4(_rays_corner, 0.0, 0.0);\n"
+			"  " + V_COLOR    + " = " + A_COLOR + ";\n"
+			"  gl_Position    = vec4(\n"
+			"    " + A_POSITION + ".xy + _rays_offset / _rays_scale, " + A_POSITION + ".zw);\n"
+			"}\n";
+		return Shader(
+			"varying vec4 " + V_TEXCOORD + ";\n"
+			"varying vec4 " + V_COLOR + ";\n"
+			"void main ()\n"
+			"{\n"
+			"  vec2 _rays_corner = " + V_TEXCOORD + ".xy;\n"
+			"  if (dot(_rays_corner, _rays_corner) > 1.0) discard;\n"
+			"  gl_FragColor = " + V_COLOR + ";\n"
+			"}\n",
+			vertex_shader_source);
+	}
+
 	const ShaderProgram*
 	Shader_get_program (const Shader& shader)
 	{
@@ -157,6 +312,12 @@ namespace Rays
 		return ShaderEnv_get_builtin_variable_names(shader.self->env);
 	}
 
+	bool
+	Shader_is_batchable (const Shader& shader)
+	{
+		return shader.self->program && shader.self->batchable;
+	}
+
 	const Shader&
 	Shader_get_default_shader_for_shape ()
 	{
@@ -187,6 +348,20 @@ namespace Rays
 		return SHADER;
 	}
 
+	const Shader&
+	Shader_get_shader_for_shape_sdf ()
+	{
+		static const Shader SHADER = make_shader_for_shape_sdf();
+		return SHADER;
+	}
+
+	const Shader&
+	Shader_get_shader_for_stroke ()
+	{
+		static const Shader SHADER = make_shader_for_stroke();
+		return SHADER;
+	}
+
 
 	Shader::Shader (
 		const char* fragment_shader_source,
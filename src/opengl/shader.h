@@ -59,12 +59,23 @@ namespace Rays
 	const ShaderBuiltinVariableNames& Shader_get_builtin_variable_names (
 		const Shader& shader);
 
+	// Returns true if the shader was created with ShaderEnv::BATCHABLE.
+	bool Shader_is_batchable (const Shader& shader);
+
 	const Shader& Shader_get_default_shader_for_shape ();
 
 	const Shader& Shader_get_default_shader_for_texture (TexCoordWrap wrap);
 
 	const Shader& Shader_get_shader_for_text ();
 
+	// Returns the shader that draws rects and ellipses from the signed
+	// distances to their outlines, see Painter_draw_sdf_shape().
+	const Shader& Shader_get_shader_for_shape_sdf ();
+
+	// Returns the shader that extrudes the centerlines of strokes in the
+	// vertex shader, see Painter_extrude_stroke().
+	const Shader& Shader_get_shader_for_stroke ();
+
 
 	const ShaderBuiltinVariableNames& ShaderEnv_get_builtin_variable_names (
 		const ShaderEnv& env);
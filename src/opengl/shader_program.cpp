@@ -10,6 +10,7 @@
 #include "texture.h"
 #include "shader.h"
 #include "shader_source.h"
+#include "opengl_state.h"
 
 
 namespace Rays
@@ -38,6 +39,8 @@ namespace Rays
 
 			virtual bool apply (size_t index, GLint location) const = 0;
 
+			virtual bool equals (const UniformValue& value) const = 0;
+
 	};// UniformValue
 
 
@@ -92,6 +95,12 @@ namespace Rays
 
 			void apply_value (GLint location) const;
 
+			bool equals (const UniformValue& value) const
+			{
+				auto* p = dynamic_cast<const UniformValueT*>(&value);
+				return p && std::equal(array, array + DIMENSION, p->array);
+			}
+
 		private:
 
 			T array[DIMENSION];
@@ -168,12 +177,20 @@ namespace Rays
 				if (unit >= max)
 					shader_error(__FILE__, __LINE__, "texture unit must be less than %d", max);
 
-				glActiveTexture(GL_TEXTURE0 + unit);
-				glBindTexture(GL_TEXTURE_2D, Texture_get_id(texture));
+				Texture_wait_for_drawing(texture);
+
+				OpenGLState_active_texture(GL_TEXTURE0 + unit);
+				OpenGLState_bind_texture(Texture_get_id(texture));
 				glUniform1i(location, unit);
 				return !OpenGL_has_error();
 			}
 
+			bool equals (const UniformValue& value) const
+			{
+				auto* p = dynamic_cast<const UniformTexture*>(&value);
+				return p && p->texture == texture;
+			}
+
 		private:
 
 			Texture texture;
@@ -189,10 +206,14 @@ namespace Rays
 
 			String name;
 
-			std::unique_ptr<const UniformValue> value;
+			std::shared_ptr<const UniformValue> value;
 
 			bool applied = false;
 
+			GLuint program_id = 0;
+
+			GLint location    = -1;
+
 		};// Data
 
 		Xot::PSharedImpl<Data> self;
@@ -209,6 +230,14 @@ namespace Rays
 			self->name = name;
 		}
 
+		Uniform (const Data& data)
+		{
+			self->name       = data.name;
+			self->value      = data.value;
+			self->program_id = data.program_id;
+			self->location   = data.location;
+		}
+
 		void reset (const UniformValue* value)
 		{
 			if (!value)
@@ -220,17 +249,22 @@ namespace Rays
 
 		void apply (
 			size_t index, const ShaderProgram& program,
-			bool ignore_no_uniform_location_error) const
+			bool ignore_no_uniform_location_error, bool force = false) const
 		{
-			if (!program || self->applied) return;
+			if (!program || (self->applied && !force)) return;
 			self->applied = true;
 
 			const char* name = self->name;
-			GLint location = glGetUniformLocation(program.id(), name);
-			if (location < 0 && !ignore_no_uniform_location_error)
+			if (self->program_id != program.id())
+			{
+				self->program_id = program.id();
+				self->location   = glGetUniformLocation(self->program_id, name);
+			}
+
+			if (self->location < 0 && !ignore_no_uniform_location_error)
 				shader_error(__FILE__, __LINE__, "uniform location '%s' not found", name);
 
-			if (!self->value->apply(index, location))
+			if (!self->value->apply(index, self->location))
 				shader_error(__FILE__, __LINE__, "failed to apply uniform variable '%s'", name);
 		}
 
@@ -250,6 +284,16 @@ namespace Rays
 	typedef std::vector<Uniform> UniformList;
 
 
+	struct ShaderUniformValues
+	{
+
+		uint version;
+
+		UniformList values, textures;
+
+	};// ShaderUniformValues
+
+
 	struct ShaderProgram::Data
 	{
 
@@ -261,8 +305,14 @@ namespace Rays
 
 		UniformList uniform_values, uniform_textures;
 
+		uint uniform_version = 0;
+
+		mutable ShaderUniformSnapshot uniform_snapshot;
+
 		mutable bool linked = false, applied = false;
 
+		mutable ShaderBuiltinVariableLocations builtin_locations;
+
 		Data ()
 		{
 			id = glCreateProgram();
@@ -272,7 +322,11 @@ namespace Rays
 
 		~Data ()
 		{
-			if (id > 0) glDeleteProgram(id);
+			if (id > 0)
+			{
+				glDeleteProgram(id);
+				OpenGLState_forget_program(id);
+			}
 
 			uniform_values.clear();
 			uniform_textures.clear();
@@ -296,17 +350,26 @@ namespace Rays
 		{
 			assert(uniforms);
 
+			std::unique_ptr<const UniformValue> pvalue(value);
+
 			auto it = std::find_if(
 				uniforms->begin(), uniforms->end(), [&](const Uniform& uniform) {
 					return uniform.self->name == name;
 				});
 
 			if (it != uniforms->end())
-				it->reset(value);
+			{
+				// setting the same value again keeps the batched draws going.
+				if (pvalue && it->self->value->equals(*pvalue))
+					return;
+
+				it->reset(pvalue.release());
+			}
 			else
-				uniforms->push_back(Uniform(name, value));
+				uniforms->push_back(Uniform(name, pvalue.release()));
 
 			applied = false;
+			++uniform_version;
 		}
 
 		bool is_valid () const
@@ -351,6 +414,51 @@ namespace Rays
 			glGetProgramiv(id, GL_VALIDATE_STATUS, &validate);
 			if (validate == GL_FALSE)
 				OpenGL_check_error(__FILE__, __LINE__, "shader program validation failed");
+
+			resolve_builtin_locations();
+		}
+
+		void resolve_builtin_locations () const
+		{
+			const auto& names = ShaderEnv_get_builtin_variable_names(env);
+			auto& locs        = builtin_locations;
+
+			get_attrib_locations(&locs.attribute_position_locations,     names.attribute_position_names);
+			get_attrib_locations(&locs.attribute_texcoord_locations,     names.attribute_texcoord_names);
+			get_attrib_locations(&locs.attribute_texcoord_min_locations, names.attribute_texcoord_min_names);
+			get_attrib_locations(&locs.attribute_texcoord_max_locations, names.attribute_texcoord_max_names);
+			get_attrib_locations(&locs.attribute_color_locations,        names.attribute_color_names);
+
+			get_uniform_locations(&locs.uniform_position_matrix_locations, names.uniform_position_matrix_names);
+			get_uniform_locations(&locs.uniform_texcoord_matrix_locations, names.uniform_texcoord_matrix_names);
+			get_uniform_locations(&locs.uniform_texcoord_pixel_locations,  names.uniform_texcoord_pixel_names);
+			get_uniform_locations(&locs.uniform_texture_locations,         names.uniform_texture_names);
+		}
+
+		void get_attrib_locations (
+			ShaderBuiltinVariableLocations::LocationList* locations,
+			const ShaderEnv::NameList& names) const
+		{
+			locations->clear();
+			for (const auto& name : names)
+			{
+				GLint loc = glGetAttribLocation(id, name.c_str());
+				if (loc >= 0) locations->push_back(loc);
+			}
+			OpenGL_check_error(__FILE__, __LINE__);
+		}
+
+		void get_uniform_locations (
+			ShaderBuiltinVariableLocations::LocationList* locations,
+			const ShaderEnv::NameList& names) const
+		{
+			locations->clear();
+			for (const auto& name : names)
+			{
+				GLint loc = glGetUniformLocation(id, name.c_str());
+				if (loc >= 0) locations->push_back(loc);
+			}
+			OpenGL_check_error(__FILE__, __LINE__);
 		}
 
 		void attach_shader (const ShaderSource& source) const
@@ -377,14 +485,47 @@ namespace Rays
 			return &buffer[0];
 		}
 
-		void apply_uniforms (const ShaderProgram& program) const
+		ShaderUniformSnapshot get_uniform_snapshot () const
 		{
-			if (applied) return;
-			applied = true;
+			if (uniform_snapshot && uniform_snapshot->version == uniform_version)
+				return uniform_snapshot;
+
+			auto snapshot     = std::make_shared<ShaderUniformValues>();
+			snapshot->version = uniform_version;
+			for (const auto& uniform : uniform_values)
+				snapshot->values.emplace_back(*uniform.self);
+			for (const auto& uniform : uniform_textures)
+				snapshot->textures.emplace_back(*uniform.self);
+
+			uniform_snapshot = snapshot;
+			return uniform_snapshot;
+		}
 
+		void apply_uniforms (
+			const ShaderProgram& program, const ShaderUniformValues* snapshot) const
+		{
 			bool ignore_no_loc =
 				ShaderEnv_get_flags(env) & ShaderEnv::IGNORE_NO_UNIFORM_LOCATION_ERROR;
 
+			if (snapshot && snapshot->version != uniform_version)
+			{
+				for (size_t i = 0; i < snapshot->values.size(); ++i)
+					snapshot->values[i].apply(i, program, ignore_no_loc, true);
+
+				for (size_t i = 0; i < snapshot->textures.size(); ++i)
+					snapshot->textures[i].apply(i, program, ignore_no_loc, true);
+
+				// the program holds older values now, so the current ones have
+				// to be applied again on the next activation.
+				applied = false;
+				for (const auto& uniform : uniform_values)   uniform.self->applied = false;
+				for (const auto& uniform : uniform_textures) uniform.self->applied = false;
+				return;
+			}
+
+			if (applied) return;
+			applied = true;
+
 			for (size_t i = 0; i < uniform_values.size(); ++i)
 				uniform_values[i].apply(i, program, ignore_no_loc);
 
@@ -396,7 +537,8 @@ namespace Rays
 
 
 	void
-	ShaderProgram_activate (const ShaderProgram& program)
+	ShaderProgram_activate (
+		const ShaderProgram& program, const ShaderUniformValues* uniforms)
 	{
 		ShaderProgram::Data* self = program.self.get();
 
@@ -404,17 +546,36 @@ namespace Rays
 
 		self->link();
 
-		glUseProgram(program.id());
-		OpenGL_check_error(__FILE__, __LINE__);
+		OpenGLState_use_program(program.id());
+
+		self->apply_uniforms(program, uniforms);
+	}
 
-		self->apply_uniforms(program);
+	uint
+	ShaderProgram_get_uniform_version (const ShaderProgram& program)
+	{
+		return program.self->uniform_version;
+	}
+
+	ShaderUniformSnapshot
+	ShaderProgram_get_uniform_snapshot (const ShaderProgram& program)
+	{
+		return program.self->get_uniform_snapshot();
+	}
+
+	const ShaderBuiltinVariableLocations&
+	ShaderProgram_get_builtin_variable_locations (const ShaderProgram& program)
+	{
+		const ShaderProgram::Data* self = program.self.get();
+
+		self->link();
+		return self->builtin_locations;
 	}
 
 	void
 	ShaderProgram_deactivate ()
 	{
-		glUseProgram(0);
-		OpenGL_check_error(__FILE__, __LINE__);
+		OpenGLState_use_program(0);
 	}
 
 
@@ -4,6 +4,8 @@
 #define __RAYS_SRC_OPENGL_SHADER_PROGRAM_H__
 
 
+#include <vector>
+#include <memory>
 #include <xot/pimpl.h>
 #include "rays/defs.h"
 #include "rays/coord.h"
@@ -82,7 +84,43 @@ namespace Rays
 	};// ShaderProgram
 
 
-	void ShaderProgram_activate (const ShaderProgram& program);
+	struct ShaderBuiltinVariableLocations
+	{
+
+		typedef std::vector<GLint> LocationList;
+
+		LocationList attribute_position_locations;
+		LocationList attribute_texcoord_locations;
+		LocationList attribute_texcoord_min_locations;
+		LocationList attribute_texcoord_max_locations;
+		LocationList attribute_color_locations;
+
+		LocationList uniform_position_matrix_locations;
+		LocationList uniform_texcoord_matrix_locations;
+		LocationList uniform_texcoord_pixel_locations;
+		LocationList uniform_texture_locations;
+
+	};// ShaderBuiltinVariableLocations
+
+
+	struct ShaderUniformValues;
+
+	// The uniform values of a program at the time the snapshot was taken.
+	typedef std::shared_ptr<const ShaderUniformValues> ShaderUniformSnapshot;
+
+	// Applies the uniform values of the snapshot instead of the current ones
+	// if the snapshot is given.
+	void ShaderProgram_activate (
+		const ShaderProgram& program, const ShaderUniformValues* uniforms = NULL);
+
+	// Incremented every time a uniform variable is set to a different value.
+	uint ShaderProgram_get_uniform_version (const ShaderProgram& program);
+
+	ShaderUniformSnapshot ShaderProgram_get_uniform_snapshot (
+		const ShaderProgram& program);
+
+	const ShaderBuiltinVariableLocations& ShaderProgram_get_builtin_variable_locations (
+		const ShaderProgram& program);
 
 	void ShaderProgram_deactivate ();
 
@@ -7,23 +7,53 @@
 #include "rays/debug.h"
 #include "color_space.h"
 #include "frame_buffer.h"
+#include "opengl_state.h"
+#include "../renderer.h"
 
 
 namespace Rays
 {
 
 
+#ifdef RAYS_FENCE_SYNC
+	typedef GLsync Fence;
+#else
+	typedef void*  Fence;
+#endif
+
+
+	static bool
+	has_fence_sync ()
+	{
+#if defined(IOS)
+		return true;
+#elif defined(RAYS_FENCE_SYNC)
+		static const bool has = GLEW_VERSION_3_2 || GLEW_ARB_sync;
+		return has;
+#else
+		return false;
+#endif
+	}
+
+
 	struct Texture::Data
 	{
 
 		GLuint id = 0;
 
+		Fence fence = NULL;
+
+		// the fence is deleted in the context it was made in.
+		Context fence_context = NULL;
+
 		int width, height, width_pow2, height_pow2;
 
 		ColorSpace color_space;
 
 		bool smooth, modified;
 
+		uint version = 0;
+
 		Data ()
 		{
 			clear();
@@ -36,6 +66,7 @@ namespace Rays
 
 		void clear ()
 		{
+			delete_fence();
 			delete_texture();
 
 			width       =
@@ -54,9 +85,23 @@ namespace Rays
 			glDeleteTextures(1, &id);
 			OpenGL_check_error(__FILE__, __LINE__);
 
+			OpenGLState_forget_texture(id);
+
 			id = 0;
 		}
 
+		void delete_fence ()
+		{
+			if (!fence) return;
+
+			// the texture may be freed while no context or another one is
+			// current.
+			OpenGLState_delete_sync(fence_context, (void*) fence);
+
+			fence         = NULL;
+			fence_context = NULL;
+		}
+
 		bool has_id () const
 		{
 			return id > 0;
@@ -184,7 +229,7 @@ namespace Rays
 		assert(self && !self->has_id());
 
 		glGenTextures(1, &self->id);
-		glBindTexture(GL_TEXTURE_2D, self->id);
+		OpenGLState_bind_texture(self->id);
 		if (glIsTexture(self->id) == GL_FALSE)
 			opengl_error(__FILE__, __LINE__, "failed to create texture.");
 
@@ -234,6 +279,72 @@ namespace Rays
 		return texture.self->id;
 	}
 
+	uint
+	Texture_get_version (const Texture& texture)
+	{
+		return texture.self->version;
+	}
+
+	void
+	Texture_set_fence (Texture* texture)
+	{
+		assert(texture);
+
+		Texture::Data* self = texture->self.get();
+		self->delete_fence();
+
+		if (!has_fence_sync())
+		{
+			// no way to wait for the result later, so wait for it now.
+			glFinish();
+			return;
+		}
+
+#ifdef RAYS_FENCE_SYNC
+		self->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		OpenGL_check_error(__FILE__, __LINE__);
+
+		self->fence_context = Renderer_get_current_context();
+
+		// make sure the fence reaches the GPU so that waits on other
+		// (shared) contexts do not block forever.
+		glFlush();
+#endif
+	}
+
+	void
+	Texture_wait_for_pixels (const Texture& texture)
+	{
+		Texture::Data* self = texture.self.get();
+		if (!self->fence) return;
+
+#ifdef RAYS_FENCE_SYNC
+		GLenum result = glClientWaitSync(
+			self->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		if (result == GL_WAIT_FAILED)
+			opengl_error(__FILE__, __LINE__, "failed to wait for the texture fence.");
+#endif
+
+		self->delete_fence();
+	}
+
+	void
+	Texture_wait_for_drawing (const Texture& texture)
+	{
+		Texture::Data* self = texture.self.get();
+		if (!self->fence) return;
+
+#ifdef RAYS_FENCE_SYNC
+		GLenum result = glClientWaitSync(self->fence, 0, 0);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+			return self->delete_fence();
+
+		// the GPU waits instead of the CPU; keep the fence for later readers.
+		glWaitSync(self->fence, 0, GL_TIMEOUT_IGNORED);
+		OpenGL_check_error(__FILE__, __LINE__);
+#endif
+	}
+
 
 	Texture::Texture ()
 	{
@@ -276,9 +387,11 @@ namespace Rays
 		GLenum format, type;
 		ColorSpace_get_gl_format_and_type(&format, &type, bitmap.color_space());
 
-		glBindTexture(GL_TEXTURE_2D, self->id);
+		OpenGLState_bind_texture(self->id);
 		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, format, type, bitmap.pixels());
 
+		++self->version;
+
 		return *this;
 	}
 
@@ -328,6 +441,7 @@ namespace Rays
 	Texture::set_modified (bool modified)
 	{
 		self->modified = modified;
+		if (modified) ++self->version;
 	}
 
 	bool
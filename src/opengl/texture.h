@@ -14,6 +14,12 @@ namespace Rays
 
 	GLuint Texture_get_id (const Texture& texture);
 
+	void Texture_set_fence (Texture* texture);
+
+	void Texture_wait_for_pixels (const Texture& texture);
+
+	void Texture_wait_for_drawing (const Texture& texture);
+
 
 }// Rays
 
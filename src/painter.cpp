@@ -1,12 +1,16 @@
 #include "painter.h"
 
 
+#include <math.h>
 #include <string.h>
 #include <assert.h>
+#include <xot/util.h>
 #include "rays/exception.h"
 #include "rays/debug.h"
 #include "polygon.h"
 #include "image.h"
+#include "texture_atlas.h"
+#include "picture.h"
 
 
 namespace Rays
@@ -168,40 +172,250 @@ namespace Rays
 			this, polygon, bounds.x, bounds.y, bounds.width, bounds.height, true);
 	}
 
+	// rects without rounds, ellipses without holes or arcs, lines and
+	// points are drawn straight from the points on the stack or in the
+	// scratch buffer of the painter without making polygons, unless they
+	// have strokes with widths which need the outlines made by clipper.
+	static bool
+	can_draw_directly (Painter* painter)
+	{
+		Painter::Data* self = painter->self.get();
+
+		if (!self->is_painting())
+			invalid_state_error(__FILE__, __LINE__, "painting flag should be true.");
+
+		Color color;
+		return
+			!self->state.get_color(&color, STROKE) ||
+			self->state.stroke_width <= 0;
+	}
+
+	static void
+	draw_outline (
+		Painter* painter, const Coord3* points, size_t size, bool loop, bool fill)
+	{
+		assert(points && size > 0);
+
+		const PainterState& state = painter->self->state;
+		Color color;
+
+		if (fill && state.get_color(&color, FILL))
+			Painter_draw(painter, MODE_TRIANGLE_FAN, &color, points, size);
+
+		if (state.get_color(&color, STROKE))
+		{
+			Painter_draw(
+				painter, loop ? MODE_LINE_LOOP : MODE_LINE_STRIP, &color, points, size);
+		}
+	}
+
+	// Rects and ellipses can be drawn by the shader for SDF shapes, unless
+	// the painter has states that the shader does not follow. Strokes along
+	// the sharp corners need miter joins that the distances make.
+	static bool
+	can_draw_with_sdf (Painter* painter, bool sharp_corners)
+	{
+		Painter::Data* self       = painter->self.get();
+		const PainterState& state = self->state;
+
+		if (!self->is_painting())
+			invalid_state_error(__FILE__, __LINE__, "painting flag should be true.");
+
+		if (
+			!painter->has_flag(Painter::FLAG_SDF_SHAPES) ||
+			self->picture || state.shader || state.texture)
+		{
+			return false;
+		}
+
+		Color color;
+		return
+			!sharp_corners                         ||
+			!state.get_color(&color, STROKE)       ||
+			state.stroke_width <= 0                ||
+			(
+				state.stroke_join == JOIN_MITER &&
+				state.miter_limit >= M_SQRT2
+			);
+	}
+
+	static void
+	draw_sdf_shape (Painter* painter, SDFShape* shape)
+	{
+		assert(shape);
+
+		const PainterState& state = painter->self->state;
+		Color color;
+
+		if (state.get_color(&color, FILL))
+		{
+			// below the distance of any point inside
+			shape->distance_min = -(shape->frame.width + shape->frame.height);
+			shape->distance_max = 0;
+			Painter_draw_sdf_shape(painter, color, *shape);
+		}
+
+		if (state.get_color(&color, STROKE))
+		{
+			// the same range that the stroke of the polygon covers
+			coord width         = std::max(state.stroke_width, (coord) 0);
+			shape->distance_min = (state.stroke_outset - 1) * width;
+			shape->distance_max =  state.stroke_outset      * width;
+			Painter_draw_sdf_shape(painter, color, *shape);
+		}
+	}
+
+	static void
+	draw_points (Painter* painter, const Point* points, size_t size)
+	{
+		if (!can_draw_directly(painter))
+			return painter->polygon(create_points(points, size));
+
+		// the same short lines that create_points() makes
+		static const coord DELTA = 0.01;
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			coord x = points[i].x, y = points[i].y;
+			Point array[] = {Point(x, y), Point(x + DELTA, y + DELTA)};
+			draw_outline(painter, array, 2, false, false);
+		}
+	}
+
+	static void
+	draw_line (Painter* painter, const Point* points, size_t size, bool loop)
+	{
+		if (!can_draw_directly(painter))
+			return painter->polygon(create_line(points, size, loop));
+
+		if (size > 0)
+			draw_outline(painter, points, size, loop, false);
+	}
+
+	static void
+	draw_rect (
+		Painter* painter,
+		coord x, coord y, coord width, coord height,
+		coord round_left_top,    coord round_right_top,
+		coord round_left_bottom, coord round_right_bottom)
+	{
+		if (
+			round_left_top == round_right_top    &&
+			round_left_top == round_left_bottom  &&
+			round_left_top == round_right_bottom &&
+			round_left_top >= 0                  &&
+			can_draw_with_sdf(painter, round_left_top == 0))
+		{
+			if (width == 0 || height == 0) return;
+
+			if (width  < 0) {x += width;  width  = -width;}
+			if (height < 0) {y += height; height = -height;}
+
+			// the same round that create_rect() fixes to fit in the rect
+			SDFShape shape(SDFShape::RECT, x, y, width, height);
+			shape.round = std::min(round_left_top, std::min(width, height) / 2);
+			return draw_sdf_shape(painter, &shape);
+		}
+
+		if (
+			round_left_top    != 0 || round_right_top    != 0 ||
+			round_left_bottom != 0 || round_right_bottom != 0 ||
+			!can_draw_directly(painter))
+		{
+			return painter->polygon(create_rect(
+				x, y, width, height,
+				round_left_top,    round_right_top,
+				round_left_bottom, round_right_bottom,
+				painter->nsegment()));
+		}
+
+		if (width == 0 || height == 0) return;
+
+		// the same outline as create_rect() makes
+		const Point points[] = {
+			Point(x,         y),
+			Point(x,         y + height),
+			Point(x + width, y + height),
+			Point(x + width, y),
+		};
+		draw_outline(painter, points, 4, true, true);
+	}
+
+	static void
+	draw_ellipse (
+		Painter* painter,
+		coord x, coord y, coord width, coord height,
+		const Point& hole_size, float angle_from, float angle_to)
+	{
+		if (angle_from > angle_to)
+			std::swap(angle_from, angle_to);
+
+		bool arc = angle_to - angle_from < 360;
+		if (
+			width > 0 && height > 0 && angle_from != angle_to &&
+			can_draw_with_sdf(painter, arc))
+		{
+			SDFShape shape(SDFShape::ELLIPSE, x, y, width, height);
+			shape.hole_size.reset(fabs(hole_size.x), fabs(hole_size.y));
+			if (arc)
+			{
+				shape.radian_from = Xot::deg2rad(angle_from);
+				shape.radian_to   = Xot::deg2rad(angle_to);
+			}
+			return draw_sdf_shape(painter, &shape);
+		}
+
+		if (
+			hole_size != 0 || fabs(angle_to - angle_from) < 360 ||
+			!can_draw_directly(painter))
+		{
+			return painter->polygon(create_ellipse(
+				x, y, width, height, hole_size, angle_from, angle_to,
+				painter->nsegment()));
+		}
+
+		if (width == 0 || height == 0) return;
+
+		std::vector<Point>& points = painter->self->bulk_points;
+		Polygon_get_ellipse_points(&points, x, y, width, height, painter->nsegment());
+		draw_outline(painter, &points[0], points.size(), true, true);
+	}
+
 	void
 	Painter::point (coord x, coord y)
 	{
-		polygon(create_point(x, y));
+		point(Point(x, y));
 	}
 
 	void
 	Painter::point (const Point& point)
 	{
-		polygon(create_point(point));
+		draw_points(this, &point, 1);
 	}
 
 	void
 	Painter::points (const Point* points, size_t size)
 	{
-		polygon(create_points(points, size));
+		draw_points(this, points, size);
 	}
 
 	void
 	Painter::line (coord x1, coord y1, coord x2, coord y2)
 	{
-		polygon(create_line(x1, y1, x2, y2));
+		line(Point(x1, y1), Point(x2, y2));
 	}
 
 	void
 	Painter::line (const Point& p1, const Point& p2)
 	{
-		polygon(create_line(p1, p2));
+		const Point points[] = {p1, p2};
+		draw_line(this, points, 2, false);
 	}
 
 	void
 	Painter::line (const Point* points, size_t size, bool loop)
 	{
-		polygon(create_line(points, size, loop));
+		draw_line(this, points, size, loop);
 	}
 
 	void
@@ -213,7 +427,7 @@ namespace Rays
 	void
 	Painter::rect (coord x, coord y, coord width, coord height, coord round)
 	{
-		polygon(create_rect(x, y, width, height, round, nsegment()));
+		draw_rect(this, x, y, width, height, round, round, round, round);
 	}
 
 	void
@@ -222,17 +436,18 @@ namespace Rays
 		coord round_left_top,    coord round_right_top,
 		coord round_left_bottom, coord round_right_bottom)
 	{
-		polygon(create_rect(
-			x, y, width, height,
+		draw_rect(
+			this, x, y, width, height,
 			round_left_top,    round_right_top,
-			round_left_bottom, round_right_bottom,
-			nsegment()));
+			round_left_bottom, round_right_bottom);
 	}
 
 	void
 	Painter::rect (const Bounds& bounds, coord round)
 	{
-		polygon(create_rect(bounds, round, nsegment()));
+		draw_rect(
+			this, bounds.x, bounds.y, bounds.width, bounds.height,
+			round, round, round, round);
 	}
 
 	void
@@ -241,11 +456,10 @@ namespace Rays
 		coord round_left_top,    coord round_right_top,
 		coord round_left_bottom, coord round_right_bottom)
 	{
-		polygon(create_rect(
-			bounds,
+		draw_rect(
+			this, bounds.x, bounds.y, bounds.width, bounds.height,
 			round_left_top,    round_right_top,
-			round_left_bottom, round_right_bottom,
-			nsegment()));
+			round_left_bottom, round_right_bottom);
 	}
 
 	void
@@ -254,8 +468,8 @@ namespace Rays
 		const Point& hole_size,
 		float angle_from, float angle_to)
 	{
-		polygon(create_ellipse(
-			x, y, width, height, hole_size, angle_from, angle_to, nsegment()));
+		draw_ellipse(
+			this, x, y, width, height, hole_size, angle_from, angle_to);
 	}
 
 	void
@@ -264,8 +478,9 @@ namespace Rays
 		const Point& hole_size,
 		float angle_from, float angle_to)
 	{
-		polygon(create_ellipse(
-			bounds, hole_size, angle_from, angle_to, nsegment()));
+		draw_ellipse(
+			this, bounds.x, bounds.y, bounds.width, bounds.height,
+			hole_size, angle_from, angle_to);
 	}
 
 	void
@@ -273,8 +488,181 @@ namespace Rays
 		const Point& center, const Point& radius, const Point& hole_radius,
 		float angle_from, float angle_to)
 	{
-		polygon(create_ellipse(
-			center, radius, hole_radius, angle_from, angle_to, nsegment()));
+		draw_ellipse(
+			this,
+			center.x - radius.x, center.y - radius.y, radius.x * 2, radius.y * 2,
+			hole_radius * 2, angle_from, angle_to);
+	}
+
+	static bool
+	get_bulk_fill_color (
+		Color* color, Painter* painter, const Color* colors, size_t size)
+	{
+		assert(color && painter);
+
+		Painter::Data* self = painter->self.get();
+
+		if (!self->is_painting())
+			invalid_state_error(__FILE__, __LINE__, "painting flag should be true.");
+
+		if (size <= 0)
+			return false;
+
+		return colors || self->state.get_color(color, FILL);
+	}
+
+	static bool
+	has_stroke (Painter* painter)
+	{
+		Color color;
+		return painter->self->state.get_color(&color, STROKE);
+	}
+
+	template <typename FUN>
+	static void
+	draw_shapes_one_by_one (
+		Painter* painter, const Color* colors, size_t size, FUN draw_shape)
+	{
+		// a stroke has to be drawn over the fill of its own shape before the
+		// next shape is drawn, which the bulk path cannot keep.
+		Painter::Data* self = painter->self.get();
+		Color fill          = self->state.  colors[FILL];
+		bool nofill         = self->state.nocolors[FILL];
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			if (colors) painter->set_fill(colors[i]);
+			draw_shape(i);
+		}
+
+		self->state.  colors[FILL] = fill;
+		self->state.nocolors[FILL] = nofill;
+	}
+
+	static void
+	draw_bulk_triangles (
+		Painter* painter, const Color& color, bool per_vertex_colors,
+		const TextureInfo* texinfo = NULL)
+	{
+		Painter::Data* self = painter->self.get();
+		if (self->bulk_points.empty()) return;
+
+		Painter_draw(
+			painter, MODE_TRIANGLES, &color,
+			&self->bulk_points[0],  self->bulk_points.size(),
+			&self->bulk_indices[0], self->bulk_indices.size(),
+			per_vertex_colors  ? &self->bulk_colors[0]    : NULL,
+			texinfo            ? &self->bulk_texcoords[0] : NULL,
+			texinfo);
+	}
+
+	static void
+	clear_bulk_buffers (Painter::Data* self)
+	{
+		self->bulk_points        .clear();
+		self->bulk_texcoords     .clear();
+		self->bulk_texcoord_mins .clear();
+		self->bulk_texcoord_maxes.clear();
+		self->bulk_colors        .clear();
+		self->bulk_indices       .clear();
+	}
+
+	static void
+	add_bulk_fan (Painter::Data* self, size_t npoints)
+	{
+		// the same triangles that MODE_TRIANGLE_FAN makes from the outline
+		uint base = (uint) (self->bulk_points.size() - npoints);
+		for (uint i = 1; i + 1 < npoints; ++i)
+		{
+			self->bulk_indices.push_back(base);
+			self->bulk_indices.push_back(base + i);
+			self->bulk_indices.push_back(base + i + 1);
+		}
+	}
+
+	static void
+	add_bulk_colors (Painter::Data* self, const Color* colors, size_t index, size_t npoints)
+	{
+		if (!colors) return;
+
+		for (size_t i = 0; i < npoints; ++i)
+			self->bulk_colors.emplace_back(colors[index]);
+	}
+
+	void
+	Painter::rects (const Bounds* bounds, const Color* colors, size_t size)
+	{
+		if (!bounds && size > 0)
+			argument_error(__FILE__, __LINE__);
+
+		Color color;
+		if (!get_bulk_fill_color(&color, this, colors, size))
+		{
+			if (has_stroke(this))
+				for (size_t i = 0; i < size; ++i) rect(bounds[i]);
+			return;
+		}
+
+		if (has_stroke(this))
+		{
+			return draw_shapes_one_by_one(this, colors, size, [&](size_t i) {
+				rect(bounds[i]);
+			});
+		}
+
+		clear_bulk_buffers(self.get());
+		for (size_t i = 0; i < size; ++i)
+		{
+			const Bounds& b = bounds[i];
+			if (b.width == 0 || b.height == 0) continue;
+
+			// the same outline as create_rect() makes
+			self->bulk_points.emplace_back(b.x,           b.y);
+			self->bulk_points.emplace_back(b.x,           b.y + b.height);
+			self->bulk_points.emplace_back(b.x + b.width, b.y + b.height);
+			self->bulk_points.emplace_back(b.x + b.width, b.y);
+			add_bulk_fan(self.get(), 4);
+			add_bulk_colors(self.get(), colors, i, 4);
+		}
+		draw_bulk_triangles(this, color, colors != NULL);
+	}
+
+	void
+	Painter::ellipses (const Bounds* bounds, const Color* colors, size_t size)
+	{
+		if (!bounds && size > 0)
+			argument_error(__FILE__, __LINE__);
+
+		Color color;
+		if (!get_bulk_fill_color(&color, this, colors, size))
+		{
+			if (has_stroke(this))
+				for (size_t i = 0; i < size; ++i) ellipse(bounds[i]);
+			return;
+		}
+
+		if (has_stroke(this))
+		{
+			return draw_shapes_one_by_one(this, colors, size, [&](size_t i) {
+				ellipse(bounds[i]);
+			});
+		}
+
+		std::vector<Point>& unit = self->bulk_shape;
+		Polygon_get_ellipse_points(&unit, 0, 0, 1, 1, nsegment());
+
+		clear_bulk_buffers(self.get());
+		for (size_t i = 0; i < size; ++i)
+		{
+			const Bounds& b = bounds[i];
+			if (b.width == 0 || b.height == 0) continue;
+
+			for (const auto& p : unit)
+				self->bulk_points.emplace_back(b.x + b.width * p.x, b.y + b.height * p.y);
+			add_bulk_fan(self.get(), unit.size());
+			add_bulk_colors(self.get(), colors, i, unit.size());
+		}
+		draw_bulk_triangles(this, color, colors != NULL);
 	}
 
 	void
@@ -323,6 +711,37 @@ namespace Rays
 		polygon(create_bezier(points, size, loop, nsegment()));
 	}
 
+	static const Texture*
+	get_image_texture (
+		Image* page, Point* offset,
+		Painter* painter, const Image& image, const Shader* shader)
+	{
+		assert(page && offset && painter && image);
+
+		offset->reset(0, 0);
+
+		// a picture keeps the image and gets its texture when it is drawn
+		static const Texture NULL_TEXTURE;
+		if (painter->self->picture)
+			return &NULL_TEXTURE;
+
+		const Texture* texture = &Image_get_texture(image);
+		if (!*texture)
+			invalid_state_error(__FILE__, __LINE__);
+
+		const PainterState& state = painter->self->state;
+		if (
+			painter->has_flag(Painter::FLAG_TEXTURE_ATLAS) &&
+			!shader && !state.shader                      &&
+			state.texcoord_mode == TEXCOORD_IMAGE         &&
+			TextureAtlas_get(page, offset, image, painter))
+		{
+			// draw from the shared page so that images stay in the same batch
+			texture = &Image_get_texture(*page);
+		}
+		return texture;
+	}
+
 	void
 	Painter_draw_image (
 		Painter* painter, const Image& image,
@@ -341,13 +760,13 @@ namespace Rays
 		if (!self->state.get_color(&color, FILL))
 			return;
 
-		const Texture& texture = Image_get_texture(image);
-		if (!texture)
-			invalid_state_error(__FILE__, __LINE__);
+		Image page;
+		Point offset;
+		const Texture* texture = get_image_texture(&page, &offset, painter, image, shader);
 
 		float density = image.pixel_density();
-		src_x *= density;
-		src_y *= density;
+		src_x = src_x * density + offset.x;
+		src_y = src_y * density + offset.y;
 		src_w *= density;
 		src_h *= density;
 
@@ -361,7 +780,8 @@ namespace Rays
 		texcoords[2].reset(src_x + src_w, src_y + src_h);
 		texcoords[3].reset(src_x + src_w, src_y);
 
-		TextureInfo texinfo(texture, src_x, src_y, src_x + src_w, src_y + src_h);
+		TextureInfo texinfo(*texture, src_x, src_y, src_x + src_w, src_y + src_h);
+		texinfo.image = &image;
 
 		Painter_draw(
 			painter, MODE_TRIANGLE_FAN, &color, points, 4, NULL, 0, NULL, texcoords,
@@ -456,6 +876,183 @@ namespace Rays
 			dst_bounds.x, dst_bounds.y, dst_bounds.width, dst_bounds.height);
 	}
 
+	void
+	Painter::images (
+		const Image& image_,
+		const Bounds* src_bounds, const Bounds* dst_bounds,
+		const Color* colors, size_t size)
+	{
+		if (!image_)
+			argument_error(__FILE__, __LINE__);
+		if (!dst_bounds && size > 0)
+			argument_error(__FILE__, __LINE__);
+
+		Color color;
+		if (!get_bulk_fill_color(&color, this, colors, size))
+			return;
+
+		Image page;
+		Point offset;
+		const Texture* texture = get_image_texture(&page, &offset, this, image_, NULL);
+
+		float density = image_.pixel_density();
+		Bounds whole(0, 0, image_.width(), image_.height());
+
+		clear_bulk_buffers(self.get());
+		for (size_t i = 0; i < size; ++i)
+		{
+			const Bounds& d = dst_bounds[i];
+			const Bounds& s = src_bounds ? src_bounds[i] : whole;
+			coord sx        = s.x * density + offset.x;
+			coord sy        = s.y * density + offset.y;
+			coord sw        = s.width  * density;
+			coord sh        = s.height * density;
+
+			// the same quad as Painter_draw_image() makes
+			self->bulk_points   .emplace_back(d.x,           d.y);
+			self->bulk_points   .emplace_back(d.x,           d.y + d.height);
+			self->bulk_points   .emplace_back(d.x + d.width, d.y + d.height);
+			self->bulk_points   .emplace_back(d.x + d.width, d.y);
+			self->bulk_texcoords.emplace_back(sx,            sy);
+			self->bulk_texcoords.emplace_back(sx,            sy + sh);
+			self->bulk_texcoords.emplace_back(sx + sw,       sy + sh);
+			self->bulk_texcoords.emplace_back(sx + sw,       sy);
+			for (int n = 0; n < 4; ++n)
+			{
+				self->bulk_texcoord_mins .emplace_back(sx,      sy);
+				self->bulk_texcoord_maxes.emplace_back(sx + sw, sy + sh);
+			}
+			add_bulk_fan(self.get(), 4);
+			add_bulk_colors(self.get(), colors, i, 4);
+		}
+
+		TextureInfo texinfo(
+			*texture,
+			offset.x,                            offset.y,
+			offset.x + image_.width() * density, offset.y + image_.height() * density);
+		texinfo.image = &image_;
+		if (!self->bulk_points.empty())
+		{
+			texinfo.point_mins  = &self->bulk_texcoord_mins[0];
+			texinfo.point_maxes = &self->bulk_texcoord_maxes[0];
+		}
+		draw_bulk_triangles(this, color, colors != NULL, &texinfo);
+	}
+
+	static void
+	draw_picture_draw (
+		Painter* painter, const Picture::Data& pic, const PictureCommand& cmd)
+	{
+		const Coord3* points    = &pic.points   [cmd.points_begin];
+		const Color*  colors    = &pic.colors   [cmd.points_begin];
+		const Coord3* texcoords = &pic.texcoords[cmd.points_begin];
+		const uint*   indices   = cmd.nindices > 0 ? &pic.indices[cmd.indices_begin] : NULL;
+		const Shader* shader    = cmd.shader ? &cmd.shader : NULL;
+
+		// a picture being recorded takes the draws of the other one as its own
+		bool recording = (bool) painter->self->picture;
+
+		// the recorded draws are submitted as they are without batching, so
+		// the texture atlas does not help them.
+		static const Texture NULL_TEXTURE;
+		const Texture& texture =
+			cmd.texture && !recording ? Image_get_texture(cmd.texture) : NULL_TEXTURE;
+		if (cmd.texture && !recording && !texture)
+			invalid_state_error(__FILE__, __LINE__);
+
+		TextureInfo texinfo_(
+			texture,
+			cmd.texcoord_min.x, cmd.texcoord_min.y,
+			cmd.texcoord_max.x, cmd.texcoord_max.y);
+		const TextureInfo* texinfo = NULL;
+		if (cmd.texture)
+		{
+			texinfo_.point_mins  = &pic.texcoord_mins [cmd.ranges_begin];
+			texinfo_.point_maxes = &pic.texcoord_maxes[cmd.ranges_begin];
+			texinfo_.image       = &cmd.texture;
+			texinfo              = &texinfo_;
+		}
+
+		if (recording)
+		{
+			Painter_draw(
+				painter, cmd.mode, NULL, points, cmd.npoints, indices, cmd.nindices,
+				colors, texcoords, texinfo, shader);
+		}
+		else
+		{
+			Painter_draw_recorded(
+				painter, cmd.mode, points, cmd.npoints, indices, cmd.nindices,
+				colors, texcoords, texinfo, shader);
+		}
+	}
+
+	static void
+	draw_picture_text (Painter* painter, const PictureCommand& cmd)
+	{
+		Painter::Data* self = painter->self.get();
+
+		self->state.  colors[FILL] = cmd.color;
+		self->state.nocolors[FILL] = false;
+
+		painter->push_matrix();
+		self->position_matrix *= cmd.matrix;
+		Painter_draw_text_line(
+			painter, cmd.font, cmd.text.c_str(), cmd.x, cmd.y, cmd.width, cmd.height);
+		painter->pop_matrix();
+	}
+
+	void
+	Painter::picture (const Picture& picture, coord x, coord y)
+	{
+		if (!picture)
+			argument_error(__FILE__, __LINE__);
+
+		if (!self->is_painting())
+			invalid_state_error(__FILE__, __LINE__, "painting flag should be true.");
+
+		const Picture::Data& pic = *picture.self;
+		if (pic.commands.empty()) return;
+
+		push_state();
+		push_matrix();
+		translate(x, y);
+		no_texture();
+
+		// the state is set only where it changes between the commands.
+		const PainterState& state = self->state;
+		for (const auto& cmd : pic.commands)
+		{
+			if (state.blend_mode    != cmd.blend_mode)
+				set_blend_mode(cmd.blend_mode);
+			if (state.texcoord_mode != cmd.texcoord_mode)
+				set_texcoord_mode(cmd.texcoord_mode);
+			if (state.texcoord_wrap != cmd.texcoord_wrap)
+				set_texcoord_wrap(cmd.texcoord_wrap);
+			if (state.shader        != cmd.state_shader)
+			{
+				if (cmd.state_shader)
+					set_shader(cmd.state_shader);
+				else
+					no_shader();
+			}
+
+			if (cmd.type == PictureCommand::TEXT)
+				draw_picture_text(this, cmd);
+			else
+				draw_picture_draw(this, pic, cmd);
+		}
+
+		pop_matrix();
+		pop_state();
+	}
+
+	void
+	Painter::picture (const Picture& picture_, const Point& position)
+	{
+		picture(picture_, position.x, position.y);
+	}
+
 	static void
 	draw_text (
 		Painter* painter, const Font& font,
@@ -959,6 +1556,12 @@ namespace Rays
 		self->position_matrix_stack.pop_back();
 	}
 
+	const Painter::Statistics&
+	Painter::statistics () const
+	{
+		return self->statistics;
+	}
+
 	void
 	Painter::add_flag (uint flags)
 	{
@@ -11,6 +11,7 @@
 #include "rays/font.h"
 #include "rays/image.h"
 #include "rays/shader.h"
+#include "rays/picture.h"
 #include "matrix.h"
 #include "texture.h"
 
@@ -59,6 +60,34 @@ namespace Rays
 	};// PrimitiveMode
 
 
+	enum FlushReason
+	{
+
+		FLUSH_EXPLICIT = 0,
+
+		FLUSH_BLEND,
+
+		FLUSH_CLIP,
+
+		FLUSH_SHADER,
+
+		FLUSH_UNIFORM,
+
+		FLUSH_TEXTURE,
+
+		FLUSH_TEXCOORD_MODE,
+
+		FLUSH_TEXCOORD_WRAP,
+
+		FLUSH_TEXT,
+
+		FLUSH_PRIMITIVE,
+
+		FLUSH_CAPACITY,
+
+	};// FlushReason
+
+
 	struct PainterState
 	{
 
@@ -145,6 +174,12 @@ namespace Rays
 
 		Point min, max;
 
+		// ranges for each point that override min and max if not NULL
+		const Coord3 *point_mins = NULL, *point_maxes = NULL;
+
+		// the image of the texture, which a picture records instead of it
+		const Image* image = NULL;
+
 		TextureInfo (
 			const Texture& texture,
 			coord x_min, coord y_min,
@@ -171,6 +206,39 @@ namespace Rays
 	};// TextureInfo
 
 
+	// A rect or an ellipse that is drawn as a single quad by the shader which
+	// evaluates the signed distance to its outline, instead of the triangles
+	// of the outline.
+	struct SDFShape
+	{
+
+		enum Type {RECT, ELLIPSE};
+
+		Type type;
+
+		Bounds frame;
+
+		// for rects
+		coord round = 0;
+
+		// for ellipses
+		Point hole_size;
+
+		// the whole ellipse if the range is empty
+		float radian_from = 0, radian_to = 0;
+
+		// the range of the distance to the outline to draw, which is negative
+		// inside of the shape.
+		coord distance_min = 0, distance_max = 0;
+
+		SDFShape (Type type, coord x, coord y, coord width, coord height)
+		:	type(type), frame(x, y, width, height)
+		{
+		}
+
+	};// SDFShape
+
+
 	struct Painter::Data
 	{
 
@@ -199,6 +267,18 @@ namespace Rays
 
 		Image text_image;
 
+		Picture picture;// records draws instead of drawing them if bound
+
+		Painter::Statistics statistics;
+
+		std::vector<Point> bulk_points, bulk_texcoords, bulk_texcoord_mins, bulk_texcoord_maxes;
+
+		std::vector<Color> bulk_colors;
+
+		std::vector<uint>  bulk_indices;
+
+		std::vector<Point> bulk_shape;// the unit shape that the bulk draws repeat
+
 		Data ()
 		{
 			state.init();
@@ -216,7 +296,7 @@ namespace Rays
 	};// Painter::Data
 
 
-	void Painter_flush (Painter* painter);
+	void Painter_flush (Painter* painter, FlushReason reason = FLUSH_EXPLICIT);
 
 	void Painter_draw (
 		Painter* painter, PrimitiveMode mode, const Color* color,
@@ -227,6 +307,31 @@ namespace Rays
 		const TextureInfo* texinfo = NULL,
 		const Shader* shader       = NULL);
 
+	// Draws the vertices recorded by a picture at once under the current
+	// matrix, without batching them again.
+	void Painter_draw_recorded (
+		Painter* painter, PrimitiveMode mode,
+		const Coord3* points,  size_t npoints,
+		const uint*   indices, size_t nindices,
+		const Color*  colors,
+		const Coord3* texcoords,
+		const TextureInfo* texinfo,
+		const Shader* shader);
+
+	// Strokes thinner than a pixel are widened to a pixel, like lines of
+	// strokes without width.
+	void Painter_draw_sdf_shape (
+		Painter* painter, const Color& color, const SDFShape& shape);
+
+	// Returns true if the strokes can be extruded by Painter_extrude_stroke().
+	bool Painter_can_extrude_stroke (Painter* painter);
+
+	// Draws the stroke along the centerline with the width, cap and join of
+	// the painter, which the vertex shader extrudes from the points.
+	void Painter_extrude_stroke (
+		Painter* painter, const Color& color,
+		const Point* points, size_t npoints, bool loop);
+
 	void Painter_draw_image (
 		Painter* painter, const Image& image,
 		coord src_x, coord src_y, coord src_w, coord src_h,
@@ -0,0 +1,353 @@
+#include "picture.h"
+
+
+#include <assert.h>
+#include <algorithm>
+#include "rays/exception.h"
+
+
+namespace Rays
+{
+
+
+	enum
+	{
+
+		// merged draws still fit into a batch with 16-bit indices.
+		MERGED_VERTICES_MAX = 65536
+
+	};
+
+
+	Picture::Picture ()
+	{
+	}
+
+	Picture::Picture (coord width, coord height)
+	{
+		if (width <= 0 || height <= 0)
+			argument_error(__FILE__, __LINE__);
+
+		self->width  = width;
+		self->height = height;
+	}
+
+	Picture::~Picture ()
+	{
+	}
+
+	Picture
+	Picture::dup () const
+	{
+		Picture p;
+		*p.self = *self;
+		return p;
+	}
+
+	void
+	Picture::clear ()
+	{
+		self->commands      .clear();
+		self->points        .clear();
+		self->texcoords     .clear();
+		self->texcoord_mins .clear();
+		self->texcoord_maxes.clear();
+		self->colors        .clear();
+		self->indices       .clear();
+	}
+
+	coord
+	Picture::width () const
+	{
+		return self->width;
+	}
+
+	coord
+	Picture::height () const
+	{
+		return self->height;
+	}
+
+	size_t
+	Picture::size () const
+	{
+		return self->commands.size();
+	}
+
+	bool
+	Picture::empty () const
+	{
+		return self->commands.empty();
+	}
+
+	Painter
+	Picture::painter ()
+	{
+		Painter p;
+		p.bind(*this);
+		return p;
+	}
+
+	Picture::operator bool () const
+	{
+		return self->width > 0 && self->height > 0;
+	}
+
+	bool
+	Picture::operator ! () const
+	{
+		return !operator bool();
+	}
+
+
+	static PrimitiveMode
+	get_merged_mode (PrimitiveMode mode, size_t nindices)
+	{
+		switch (mode)
+		{
+			case MODE_TRIANGLES:
+			case MODE_LINES:        return mode;
+			case MODE_TRIANGLE_FAN: return nindices == 0 ? MODE_TRIANGLES : MODE_NONE;
+			case MODE_LINE_STRIP:
+			case MODE_LINE_LOOP:    return nindices == 0 ? MODE_LINES     : MODE_NONE;
+			default:                return MODE_NONE;
+		}
+	}
+
+	static size_t
+	count_merged_indices (PrimitiveMode mode, size_t nindices, size_t npoints)
+	{
+		switch (mode)
+		{
+			case MODE_TRIANGLE_FAN: return npoints >= 3 ? (npoints - 2) * 3 : 0;
+			case MODE_LINE_STRIP:   return npoints >= 2 ? (npoints - 1) * 2 : 0;
+			case MODE_LINE_LOOP:    return npoints >= 2 ?  npoints      * 2 : 0;
+			default:                return nindices > 0 ? nindices : npoints;
+		}
+	}
+
+	static bool
+	is_same_texture (const Image& a, const Image* b)
+	{
+		return (!a && (!b || !*b)) || (a && b && a == *b);
+	}
+
+	static bool
+	can_merge (
+		const PictureCommand& command, PrimitiveMode mode, size_t npoints,
+		const PainterState& state, const Image* texture, const Shader& shader)
+	{
+		return
+			command.type == PictureCommand::DRAW                  &&
+			command.mode == mode                                  &&
+			command.npoints + npoints <= MERGED_VERTICES_MAX      &&
+			is_same_texture(command.texture, texture)             &&
+			command.state_shader  == state.shader                 &&
+			command.shader        == shader                       &&
+			command.blend_mode    == state.blend_mode             &&
+			command.texcoord_mode == state.texcoord_mode          &&
+			command.texcoord_wrap == state.texcoord_wrap;
+	}
+
+	static void
+	add_merged_indices (
+		std::vector<uint>* indices, uint base, PrimitiveMode mode,
+		const uint* src, size_t nsrc, size_t npoints)
+	{
+		switch (mode)
+		{
+			case MODE_TRIANGLE_FAN:
+				for (uint i = 1; i + 1 < npoints; ++i)
+				{
+					indices->push_back(base);
+					indices->push_back(base + i);
+					indices->push_back(base + i + 1);
+				}
+				break;
+
+			case MODE_LINE_STRIP:
+			case MODE_LINE_LOOP:
+				for (uint i = 0; i + 1 < npoints; ++i)
+				{
+					indices->push_back(base + i);
+					indices->push_back(base + i + 1);
+				}
+				if (mode == MODE_LINE_LOOP)
+				{
+					indices->push_back(base + (uint) npoints - 1);
+					indices->push_back(base);
+				}
+				break;
+
+			default:
+				if (src && nsrc > 0)
+				{
+					for (size_t i = 0; i < nsrc; ++i)
+						indices->push_back(base + src[i]);
+				}
+				else
+				{
+					for (uint i = 0; i < npoints; ++i)
+						indices->push_back(base + i);
+				}
+				break;
+		}
+	}
+
+	static PictureCommand*
+	add_command (
+		Picture::Data* self, PictureCommand::Type type,
+		const PainterState& state, const Shader& shader)
+	{
+		self->commands.emplace_back();
+
+		PictureCommand* cmd  = &self->commands.back();
+		cmd->type            = type;
+		cmd->mode            = MODE_NONE;
+		cmd->points_begin    = self->points.size();
+		cmd->npoints         = 0;
+		cmd->indices_begin   = self->indices.size();
+		cmd->nindices        = 0;
+		cmd->ranges_begin    = self->texcoord_mins.size();
+		cmd->state_shader    = state.shader;
+		cmd->shader          = shader;
+		cmd->blend_mode      = state.blend_mode;
+		cmd->texcoord_mode   = state.texcoord_mode;
+		cmd->texcoord_wrap   = state.texcoord_wrap;
+		cmd->x = cmd->y = cmd->width = cmd->height = 0;
+		return cmd;
+	}
+
+	void
+	Picture_add_draw (
+		Picture* picture, const PainterState& state, const Matrix& matrix,
+		PrimitiveMode mode, const Color* color,
+		const Coord3* points,  size_t npoints,
+		const uint*   indices, size_t nindices,
+		const Color*  colors,
+		const Coord3* texcoords,
+		const TextureInfo* texinfo,
+		const Shader* shader)
+	{
+		assert(picture && points && npoints > 0);
+
+		Picture::Data* self = picture->self.get();
+
+		// keep the image instead of its texture, so that recording does not
+		// need an OpenGL context.
+		const Image* texture = NULL;
+		Point texcoord_min, texcoord_max;
+		if (texinfo)
+		{
+			if (!texinfo->image)
+				invalid_state_error(__FILE__, __LINE__, "no image for the texture.");
+
+			texture      = texinfo->image;
+			texcoord_min = texinfo->min;
+			texcoord_max = texinfo->max;
+		}
+		else if (state.texture)
+		{
+			float density = state.texture.pixel_density();
+			texture       = &state.texture;
+			texcoord_max.reset(
+				state.texture.width() * density, state.texture.height() * density);
+		}
+
+		Shader shader_       = shader ? *shader : Shader();
+		PrimitiveMode merged = get_merged_mode(mode, nindices);
+		if (
+			merged != MODE_NONE &&
+			count_merged_indices(mode, nindices, npoints) == 0)
+		{
+			return;
+		}
+
+		PictureCommand* cmd =
+			self->commands.empty() ? NULL : &self->commands.back();
+		if (
+			merged == MODE_NONE ||
+			!cmd                ||
+			!can_merge(*cmd, merged, npoints, state, texture, shader_))
+		{
+			cmd       = add_command(self, PictureCommand::DRAW, state, shader_);
+			cmd->mode = merged != MODE_NONE ? merged : mode;
+			if (texture)
+			{
+				cmd->texture      = *texture;
+				cmd->texcoord_min = texcoord_min;
+				cmd->texcoord_max = texcoord_max;
+			}
+		}
+
+		uint base = (uint) cmd->npoints;
+
+		for (size_t i = 0; i < npoints; ++i)
+		{
+			const Coord3& p = points[i];
+			self->points.emplace_back(matrix * Point(p.x, p.y, p.z));
+		}
+
+		Color white(1, 1);
+		for (size_t i = 0; i < npoints; ++i)
+			self->colors.emplace_back(colors ? colors[i] : color ? *color : white);
+
+		// texcoords default to the points before they are transformed
+		const Coord3* coords = texcoords ? texcoords : points;
+		for (size_t i = 0; i < npoints; ++i)
+			self->texcoords.emplace_back(coords[i].x, coords[i].y, coords[i].z);
+
+		if (texture)
+		{
+			const Coord3* mins  = texinfo ? texinfo->point_mins  : NULL;
+			const Coord3* maxes = texinfo ? texinfo->point_maxes : NULL;
+			for (size_t i = 0; i < npoints; ++i)
+			{
+				const Coord3& min = mins  ? mins[i]  : texcoord_min;
+				const Coord3& max = maxes ? maxes[i] : texcoord_max;
+				self->texcoord_mins .emplace_back(min.x, min.y, min.z);
+				self->texcoord_maxes.emplace_back(max.x, max.y, max.z);
+			}
+
+			Point& cmin = cmd->texcoord_min;
+			Point& cmax = cmd->texcoord_max;
+			cmin.reset(std::min(cmin.x, texcoord_min.x), std::min(cmin.y, texcoord_min.y));
+			cmax.reset(std::max(cmax.x, texcoord_max.x), std::max(cmax.y, texcoord_max.y));
+		}
+
+		size_t nindices0 = self->indices.size();
+		if (merged != MODE_NONE)
+			add_merged_indices(&self->indices, base, mode, indices, nindices, npoints);
+		else if (indices && nindices > 0)
+			self->indices.insert(self->indices.end(), indices, indices + nindices);
+
+		cmd->npoints  += npoints;
+		cmd->nindices += self->indices.size() - nindices0;
+	}
+
+	void
+	Picture_add_text_line (
+		Picture* picture, const PainterState& state, const Matrix& matrix,
+		const Font& font, const char* line, coord x, coord y,
+		coord width, coord height)
+	{
+		assert(picture && font && line);
+
+		Color color;
+		if (!state.get_color(&color, FILL))
+			return;
+
+		PictureCommand* cmd =
+			add_command(picture->self.get(), PictureCommand::TEXT, state, Shader());
+		cmd->font   = font;
+		cmd->text   = line;
+		cmd->color  = color;
+		cmd->matrix = matrix;
+		cmd->x      = x;
+		cmd->y      = y;
+		cmd->width  = width;
+		cmd->height = height;
+	}
+
+
+}// Rays
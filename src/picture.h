@@ -0,0 +1,95 @@
+// -*- c++ -*-
+#pragma once
+#ifndef __RAYS_SRC_PICTURE_H__
+#define __RAYS_SRC_PICTURE_H__
+
+
+#include <vector>
+#include "rays/picture.h"
+#include "painter.h"
+
+
+namespace Rays
+{
+
+
+	struct PictureCommand
+	{
+
+		enum Type {DRAW, TEXT};
+
+		Type type;
+
+		PrimitiveMode mode;
+
+		// ranges in the arrays of Picture::Data. points, colors and texcoords
+		// share the same indices, texcoord_mins and texcoord_maxes are filled
+		// for the points of textured draws only.
+		size_t points_begin, npoints, indices_begin, nindices, ranges_begin;
+
+		Image texture;
+
+		Point texcoord_min, texcoord_max;
+
+		// 'state_shader' is the shader set to the painter and 'shader' is the
+		// one for the kind of the draw, such as the shader for texts.
+		Shader state_shader, shader;
+
+		BlendMode blend_mode;
+
+		TexCoordMode texcoord_mode;
+
+		TexCoordWrap texcoord_wrap;
+
+		// for texts
+		Font font;
+
+		String text;
+
+		Color color;
+
+		Matrix matrix;
+
+		coord x, y, width, height;
+
+	};// PictureCommand
+
+
+	struct Picture::Data
+	{
+
+		coord width = 0, height = 0;
+
+		std::vector<PictureCommand> commands;
+
+		std::vector<Point> points, texcoords, texcoord_mins, texcoord_maxes;
+
+		std::vector<Color> colors;
+
+		std::vector<uint>  indices;
+
+	};// Picture::Data
+
+
+	// Appends a draw of the painter whose points are transformed by 'matrix'.
+	// It is merged into the previous draw if they can be drawn at once.
+	void Picture_add_draw (
+		Picture* picture, const PainterState& state, const Matrix& matrix,
+		PrimitiveMode mode, const Color* color,
+		const Coord3* points,  size_t npoints,
+		const uint*   indices, size_t nindices,
+		const Color*  colors,
+		const Coord3* texcoords,
+		const TextureInfo* texinfo,
+		const Shader* shader);
+
+	void Picture_add_text_line (
+		Picture* picture, const PainterState& state, const Matrix& matrix,
+		const Font& font, const char* line, coord x, coord y,
+		coord width, coord height);
+
+
+}// Rays
+
+
+#endif//EOH
@@ -12,6 +12,7 @@
 #include "rays/debug.h"
 #include "polyline.h"
 #include "painter.h"
+#include "worker_pool.h"
 
 
 namespace clip = ClipperLib;
@@ -76,55 +77,263 @@ namespace Rays
 	}
 
 
-	class Triangles
+	static coord
+	get_turn (const Point& p0, const Point& p1, const Point& p2)
 	{
+		return (p1.x - p0.x) * (p2.y - p1.y) - (p1.y - p0.y) * (p2.x - p1.x);
+	}
 
-		public:
+	static bool
+	is_convex (const Point* points, size_t size)
+	{
+		assert(points);
+
+		if (size < 3) return false;
 
-			Triangles (size_t npoints)
+		// all the turns have the same direction and the edges reverse the
+		// direction along the x axis only twice, which rejects star shapes.
+		int turn = 0, xflips = 0, xdir = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			const Point& p0 = points[i];
+			const Point& p1 = points[(i + 1) % size];
+			const Point& p2 = points[(i + 2) % size];
+
+			coord t = get_turn(p0, p1, p2);
+			if (t != 0)
 			{
-				points.reserve(npoints);
+				int dir = t > 0 ? 1 : -1;
+				if (turn != 0 && dir != turn) return false;
+				turn = dir;
 			}
 
-			void append (const Polyline& polyline)
+			coord dx = p1.x - p0.x;
+			if (dx != 0)
 			{
-				if (polyline.empty()) return;
+				int dir = dx > 0 ? 1 : -1;
+				if (xdir != 0 && dir != xdir) ++xflips;
+				xdir = dir;
+			}
+		}
+
+		// the flip across the first point is not counted in the loop above.
+		for (size_t i = 0; i < size; ++i)
+		{
+			coord dx = points[(i + 1) % size].x - points[i].x;
+			if (dx == 0) continue;
 
-				const Point* points_     = polyline.points();
-				const Color* colors_     = polyline.colors();
-				const Coord3* texcoords_ = polyline.texcoords();
-				if (!points_)
-					argument_error(__FILE__, __LINE__);
+			if ((dx > 0 ? 1 : -1) != xdir) ++xflips;
+			break;
+		}
 
-				if (!points.empty() && !colors_ != !pcolors)
-					argument_error(__FILE__, __LINE__);
-				if (!points.empty() && !texcoords_ != !ptexcoords)
-					argument_error(__FILE__, __LINE__);
+		return turn != 0 && xflips <= 2;
+	}
 
-				segments.emplace_back(points.size(), 0, polyline.hole());
-				points.insert(points.end(), points_, points_ + polyline.size());
-				segments.back().end = points.size();
+	static void
+	triangulate_fan (std::vector<uint32_t>* indices, size_t size, uint32_t offset)
+	{
+		assert(indices);
 
-				if (colors_)
-				{
-					if (!pcolors)
-					{
-						pcolors.reset(new decltype(pcolors)::element_type());
-						pcolors->reserve(points.capacity());
-					}
-					pcolors->insert(pcolors->end(), colors_, colors_ + polyline.size());
-				}
+		for (uint32_t i = 1; i + 1 < size; ++i)
+		{
+			indices->emplace_back(offset);
+			indices->emplace_back(offset + i);
+			indices->emplace_back(offset + i + 1);
+		}
+	}
+
+	typedef std::vector<std::pair<uint32_t, int>> MonotoneVertexList;
 
-				if (texcoords_)
+	static bool
+	is_above (const Point& a, const Point& b)
+	{
+		return a.y < b.y || (a.y == b.y && a.x < b.x);
+	}
+
+	static bool
+	is_monotone (const Point* points, size_t size, size_t* top, size_t* bottom)
+	{
+		assert(points && top && bottom);
+
+		if (size < 4) return false;
+
+		// going around a y-monotone outline reverses the vertical direction
+		// exactly twice, at the top and at the bottom points.
+		size_t nflips = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			const Point& p0 = points[(i + size - 1) % size];
+			const Point& p1 = points[i];
+			const Point& p2 = points[(i + 1) % size];
+			if (p0 == p1 || p1 == p2) return false;
+
+			bool down0 = is_above(p0, p1), down1 = is_above(p1, p2);
+			if (down0 == down1) continue;
+
+			if (++nflips > 2) return false;
+			if (down1) *top = i; else *bottom = i;
+		}
+		return nflips == 2;
+	}
+
+	static void
+	sort_monotone (
+		MonotoneVertexList* sorted, const Point* points, size_t size,
+		size_t top, size_t bottom)
+	{
+		assert(sorted && points);
+
+		// merge the chains going forward and backward from the top point
+		// into the order of the sweep from the top to the bottom.
+		sorted->clear();
+		sorted->reserve(size);
+		sorted->emplace_back(top, 0);
+
+		size_t next = (top + 1) % size, prev = (top + size - 1) % size;
+		while (next != bottom || prev != bottom)
+		{
+			if (prev == bottom || (next != bottom && is_above(points[next], points[prev])))
+			{
+				sorted->emplace_back(next, 1);
+				next = (next + 1) % size;
+			}
+			else
+			{
+				sorted->emplace_back(prev, -1);
+				prev = (prev + size - 1) % size;
+			}
+		}
+		sorted->emplace_back(bottom, 0);
+	}
+
+	static bool
+	is_simple_monotone (
+		const Point* points, size_t size, const MonotoneVertexList& sorted)
+	{
+		assert(points && sorted.size() == size);
+
+		// monotone chains can still cross or touch each other, so every
+		// vertex has to stay on the same side of the edge of the opposite
+		// chain at its height, and no two vertices may meet.
+		size_t last[2] = {sorted.front().first, sorted.front().first};
+		int side       = 0;
+		for (size_t i = 1; i < size; ++i)
+		{
+			const auto& v  = sorted[i];
+			const Point& p = points[v.first];
+			if (p == points[sorted[i - 1].first]) return false;
+			if (i + 1 == size) break;
+
+			size_t a = last[v.second > 0 ? 0 : 1];
+			size_t b = v.second > 0 ? (a + size - 1) % size : (a + 1) % size;
+			coord turn = get_turn(points[a], points[b], p);
+			if (turn == 0) return false;
+
+			int dir = (turn > 0 ? 1 : -1) * v.second;
+			if (side != 0 && dir != side) return false;
+
+			side = dir;
+			last[v.second > 0 ? 1 : 0] = v.first;
+		}
+		return true;
+	}
+
+	static void
+	triangulate_monotone (
+		std::vector<uint32_t>* indices, const Point* points, size_t size,
+		const MonotoneVertexList& sorted, uint32_t offset,
+		MonotoneVertexList* stack_)
+	{
+		assert(indices && points && stack_ && sorted.size() == size);
+
+		coord area = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			const Point& p0 = points[i];
+			const Point& p1 = points[(i + 1) % size];
+			area += p0.x * p1.y - p1.x * p0.y;
+		}
+		int sign = area >= 0 ? 1 : -1;
+
+		auto add = [&](uint32_t a, uint32_t b, uint32_t c)
+		{
+			indices->emplace_back(offset + a);
+			indices->emplace_back(offset + b);
+			indices->emplace_back(offset + c);
+		};
+
+		auto& stack = *stack_;
+		stack.clear();
+		stack.emplace_back(sorted[0]);
+		stack.emplace_back(sorted[1]);
+
+		for (size_t j = 2; j + 1 < sorted.size(); ++j)
+		{
+			auto u = sorted[j];
+			if (u.second != stack.back().second)
+			{
+				for (size_t k = 0; k + 1 < stack.size(); ++k)
+					add(u.first, stack[k].first, stack[k + 1].first);
+
+				auto last = stack.back();
+				stack.clear();
+				stack.emplace_back(last);
+				stack.emplace_back(u);
+			}
+			else
+			{
+				auto last = stack.back();
+				stack.pop_back();
+				while (!stack.empty())
 				{
-					if (!ptexcoords)
-					{
-						ptexcoords.reset(new decltype(ptexcoords)::element_type());
-						ptexcoords->reserve(points.capacity());
-					}
-					ptexcoords->insert(
-						ptexcoords->end(), texcoords_, texcoords_ + polyline.size());
+					const Point& pu = points[u.first];
+					const Point& pl = points[last.first];
+					const Point& pt = points[stack.back().first];
+
+					// the diagonal is inside when the vertex between is convex.
+					coord turn = u.second > 0 ? get_turn(pt, pl, pu) : get_turn(pu, pl, pt);
+					if (turn * sign <= 0) break;
+
+					add(u.first, last.first, stack.back().first);
+					last = stack.back();
+					stack.pop_back();
 				}
+				stack.emplace_back(last);
+				stack.emplace_back(u);
+			}
+		}
+
+		uint32_t b = sorted.back().first;
+		for (size_t k = 0; k + 1 < stack.size(); ++k)
+			add(b, stack[k].first, stack[k + 1].first);
+	}
+
+
+	enum
+	{
+
+		// outlines are triangulated on the worker pool only when the polygon
+		// has enough points to pay for it. dispatching to the pool and joining
+		// takes about 10us, and even the convex and monotone paths spend about
+		// 35ns per point, so this is about 7 times the overhead.
+		PARALLEL_TRIANGULATE_POINTS_MIN = 2048,
+
+		// polygons are intersected on the worker pool in chunks of at least
+		// this many, since each clipper pass costs far more than the dispatch.
+		PARALLEL_REDUCE_POLYGONS_MIN = 4
+
+	};
+
+
+	class Triangles
+	{
+
+		public:
+
+			Triangles (const Polygon::PolylineList& polylines)
+			{
+				if (!share_buffer(polylines))
+					pack_buffer(polylines);
 			}
 
 			bool get (Polygon::TrianglePointList* triangles) const
@@ -132,6 +341,7 @@ namespace Rays
 				triangulate();
 				if (indices.empty()) return false;
 
+				const auto& points = buffer->points;
 				triangles->reserve(triangles->size() + indices.size());
 				for (const auto& index : indices)
 					triangles->emplace_back(points[index]);
@@ -143,14 +353,16 @@ namespace Rays
 				triangulate();
 				if (indices.empty()) return;
 
-				if (pcolors)
+				const auto& points = buffer->points;
+				const Coord3* texcoords =
+					has_texcoords ? &buffer->texcoords[0] : NULL;
+				if (has_colors)
 				{
 					draw_polygon(
 						painter, MODE_TRIANGLES,
 						&points[0],  points.size(),
 						&indices[0], indices.size(),
-						&(*pcolors)[0],
-						ptexcoords ? &(*ptexcoords)[0] : NULL);
+						&buffer->colors[0], texcoords);
 				}
 				else
 				{
@@ -158,7 +370,7 @@ namespace Rays
 						painter, MODE_TRIANGLES, color,
 						&points[0],  points.size(),
 						&indices[0], indices.size(),
-						ptexcoords ? &(*ptexcoords)[0] : NULL);
+						texcoords);
 				}
 			}
 
@@ -183,7 +395,8 @@ namespace Rays
 
 			};// Segment
 
-			class Polyline
+			// a range of the points in the buffer, earcut reads it as a ring.
+			class Ring
 			{
 
 				const Point* points;
@@ -194,7 +407,7 @@ namespace Rays
 
 					typedef Point value_type;
 
-					Polyline (const Point* points, size_t size)
+					Ring (const Point* points, size_t size)
 					:	points(points), size_(size)
 					{
 					}
@@ -205,15 +418,76 @@ namespace Rays
 
 					const Point& operator [] (size_t i) const {return points[i];}
 
-			};// Polyline
+			};// Ring
+
+			// an outline and its holes, earcut reads it as a polygon. the rings
+			// are in the array shared by all the groups.
+			struct Group
+			{
+
+				typedef Ring value_type;
+
+				const Ring* rings;
+
+				size_t size_;
+
+				uint32_t index_offset;
+
+				size_t size () const {return size_;}
+
+				bool empty () const {return size_ == 0;}
+
+				const Ring& operator [] (size_t i) const {return rings[i];}
+
+			};// Group
+
+			// keeps the work buffers to reuse them for the next groups.
+			struct Triangulator
+			{
+
+				mapbox::detail::Earcut<uint32_t> earcut;
 
-			typedef std::vector<Polyline> PolylineList;
+				MonotoneVertexList sorted, stack;
 
-			std::vector<Point> points;
+				void triangulate (std::vector<uint32_t>* indices, const Group& group)
+				{
+					uint32_t offset = group.index_offset;
 
-			std::unique_ptr<std::vector<Color>> pcolors;
+					// outlines without holes take the fast paths when they are
+					// convex or y-monotone, earcut handles the rest.
+					if (group.size() == 1)
+					{
+						const Ring& ring    = group[0];
+						const Point* points = &ring[0];
+						size_t size         = ring.size();
+
+						if (is_convex(points, size))
+							return triangulate_fan(indices, size, offset);
+
+						size_t top = 0, bottom = 0;
+						if (is_monotone(points, size, &top, &bottom))
+						{
+							sort_monotone(&sorted, points, size, top, bottom);
+							if (is_simple_monotone(points, size, sorted))
+							{
+								return triangulate_monotone(
+									indices, points, size, sorted, offset, &stack);
+							}
+						}
+					}
+
+					earcut(group);
+					for (const auto& index : earcut.indices)
+						indices->emplace_back(offset + index);
+				}
 
-			std::unique_ptr<std::vector<Coord3>> ptexcoords;
+			};// Triangulator
+
+			// the buffer of the polylines if they share one, or a copy of
+			// their points packed together.
+			std::shared_ptr<PolylineBuffer> buffer;
+
+			bool has_colors = false, has_texcoords = false;
 
 			mutable std::vector<Segment> segments;
 
@@ -223,37 +497,440 @@ namespace Rays
 			{
 				if (segments.empty()) return;
 
-				PolylineList polylines;
-				size_t index_offset = 0;
+				// each outline and its following holes make a group that is
+				// triangulated independently of the others.
+				std::vector<Ring> rings;
+				std::vector<Group> groups;
+				rings.reserve(segments.size());
 				for (const auto& seg : segments)
 				{
-					Polyline polyline(&points[0] + seg.begin, seg.end - seg.begin);
-					if (!seg.hole)
-					{
-						triangulate(polylines, index_offset);
-						polylines.clear();
-						index_offset = seg.begin;
-					}
-					polylines.emplace_back(polyline);
+					rings.emplace_back(&buffer->points[seg.begin], seg.end - seg.begin);
+					if (!seg.hole || groups.empty())
+						groups.emplace_back(Group {&rings.back(), 0, (uint32_t) seg.begin});
+					++groups.back().size_;
+				}
+
+				size_t npoints = 0;
+				for (const auto& seg : segments)
+					npoints += seg.end - seg.begin;
+
+				if (
+					groups.size() >= 2 &&
+					npoints >= PARALLEL_TRIANGULATE_POINTS_MIN)
+				{
+					triangulate_in_parallel(groups);
+				}
+				else
+				{
+					Triangulator triangulator;
+					for (const auto& group : groups)
+						triangulator.triangulate(&indices, group);
 				}
-				triangulate(polylines, index_offset);
 
 				segments.clear();
 				segments.shrink_to_fit();
 			}
 
-			void triangulate (const PolylineList& polylines, size_t index_offset) const
+			template <typename FUN>
+			void each_polyline (const Polygon::PolylineList& polylines, FUN fun)
+			{
+				bool first = true;
+				for (const auto& polyline : polylines)
+				{
+					if (polyline.empty()) continue;
+
+					if (!polyline.points())
+						argument_error(__FILE__, __LINE__);
+
+					bool colors = polyline.colors(), texcoords = polyline.texcoords();
+					if (first)
+					{
+						has_colors    = colors;
+						has_texcoords = texcoords;
+						first         = false;
+					}
+					else if (colors != has_colors || texcoords != has_texcoords)
+						argument_error(__FILE__, __LINE__);
+
+					fun(polyline);
+				}
+			}
+
+			bool share_buffer (const Polygon::PolylineList& polylines)
+			{
+				const std::shared_ptr<PolylineBuffer>* shared = NULL;
+				size_t npoints = 0;
+				for (const auto& polyline : polylines)
+				{
+					if (polyline.empty()) continue;
+
+					const auto& buf = Polyline_get_buffer(polyline);
+					if (!buf || (shared && buf != *shared)) return false;
+
+					shared   = &buf;
+					npoints += polyline.size();
+				}
+
+				// draws all the points in the buffer, so it is shared only when
+				// most of them belong to the polylines.
+				if (!shared || npoints * 2 < (*shared)->points.size())
+					return false;
+
+				buffer = *shared;
+				each_polyline(polylines, [&](const Rays::Polyline& polyline)
+				{
+					size_t offset = 0;
+					Polyline_get_buffer(polyline, &offset);
+					segments.emplace_back(
+						offset, offset + polyline.size(), polyline.hole());
+				});
+
+				// the buffer has the attributes only for a part of the points
+				// if some of the polylines sharing it do not have them.
+				size_t size = buffer->points.size();
+				return
+					(!has_colors    || buffer->colors   .size() == size) &&
+					(!has_texcoords || buffer->texcoords.size() == size);
+			}
+
+			void pack_buffer (const Polygon::PolylineList& polylines)
 			{
-				if (polylines.empty()) return;
+				segments.clear();
+				buffer = std::make_shared<PolylineBuffer>();
+
+				size_t npoints = 0;
+				for (const auto& polyline : polylines)
+					npoints += polyline.size();
+				buffer->points.reserve(npoints);
+
+				each_polyline(polylines, [&](const Rays::Polyline& polyline)
+				{
+					auto* b      = buffer.get();
+					size_t begin = b->points.size(), size = polyline.size();
+					segments.emplace_back(begin, begin + size, polyline.hole());
+
+					const Point* points = polyline.points();
+					b->points.insert(b->points.end(), points, points + size);
 
-				auto result = mapbox::earcut<uint32_t>(polylines);
-				for (const auto& index : result)
-					indices.emplace_back(index_offset + index);
+					if (has_colors)
+					{
+						const Color* colors = polyline.colors();
+						b->colors.insert(b->colors.end(), colors, colors + size);
+					}
+
+					if (has_texcoords)
+					{
+						const Coord3* texcoords = polyline.texcoords();
+						b->texcoords.insert(
+							b->texcoords.end(), texcoords, texcoords + size);
+					}
+				});
+			}
+
+			void triangulate_in_parallel (const std::vector<Group>& groups) const
+			{
+				// the groups are split into contiguous chunks, and the indices
+				// of the chunks are merged in order so that the result does not
+				// depend on the scheduling of the workers.
+				size_t nchunks =
+					std::min(groups.size(), WorkerPool_get_concurrency() * 4);
+				std::vector<std::vector<uint32_t>> chunks(nchunks);
+
+				WorkerPool_run(nchunks, [&](size_t i)
+				{
+					Triangulator triangulator;
+					size_t begin = groups.size() *  i      / nchunks;
+					size_t end   = groups.size() * (i + 1) / nchunks;
+					for (size_t g = begin; g < end; ++g)
+						triangulator.triangulate(&chunks[i], groups[g]);
+				});
+
+				for (const auto& chunk : chunks)
+					indices.insert(indices.end(), chunk.begin(), chunk.end());
 			}
 
 	};// Triangles
 
 
+	struct StrokeTriangles
+	{
+
+		coord width;
+
+		float outset;
+
+		CapType cap;
+
+		JoinType join;
+
+		coord miter_limit;
+
+		std::vector<Point> points;
+
+		std::vector<uint>  indices;
+
+		// the centerlines are kept only when the triangles may overlap, to
+		// expand them by clipper for the strokes that must not blend twice.
+		Polygon::PolylineList overlapping_centerlines;
+
+		mutable std::unique_ptr<Triangles> poutlines;
+
+		StrokeTriangles (
+			coord width, float outset, CapType cap, JoinType join, coord miter_limit)
+		:	width(width), outset(outset), cap(cap), join(join),
+			miter_limit(miter_limit)
+		{
+		}
+
+		bool match (
+			coord width, float outset,
+			CapType cap, JoinType join, coord miter_limit) const
+		{
+			return
+				this->width       == width  &&
+				this->outset      == outset &&
+				this->cap         == cap    &&
+				this->join        == join   &&
+				this->miter_limit == miter_limit;
+		}
+
+		void draw (Painter* painter, const Color& color) const
+		{
+			if (!overlapping_centerlines.empty() && !is_opaque(painter, color))
+				return outlines().draw(painter, color);
+
+			if (indices.empty()) return;
+
+			draw_polygon(
+				painter, MODE_TRIANGLES, color,
+				&points[0],  points.size(),
+				&indices[0], indices.size());
+		}
+
+		private:
+
+			// overdrawing the same pixels changes nothing then.
+			static bool is_opaque (Painter* painter, const Color& color)
+			{
+				BlendMode mode = painter->blend_mode();
+				return
+					color.alpha >= 1 && !painter->shader() &&
+					(mode == BLEND_NORMAL || mode == BLEND_REPLACE);
+			}
+
+			const Triangles& outlines () const
+			{
+				if (poutlines) return *poutlines;
+
+				Polygon::PolylineList polylines;
+				for (const auto& centerline : overlapping_centerlines)
+				{
+					Polygon stroke;
+					if (!Polyline_expand(
+						&stroke, centerline, width / 2, cap, join, miter_limit))
+					{
+						continue;
+					}
+
+					for (const auto& outline : stroke)
+					{
+						if ((outline.fill() || outline.hole()) && outline.size() >= 3)
+							polylines.emplace_back(outline);
+					}
+				}
+
+				poutlines.reset(new Triangles(polylines));
+				return *poutlines;
+			}
+
+	};// StrokeTriangles
+
+
+	class EdgeGrid
+	{
+
+		public:
+
+			EdgeGrid (const Polygon::PolylineList& polylines)
+			{
+				for (const auto& polyline : polylines)
+					add_edges(polyline);
+
+				if (!edges.empty()) build();
+			}
+
+			bool contains (const Point& point) const
+			{
+				if (edges.empty() || !is_in_bounds(point, 0)) return false;
+
+				// counts the crossings of a ray going to +x, each crossing is
+				// counted only in the cell where it lies.
+				int row  = get_row(point.y), col = get_col(point.x);
+				bool odd = false;
+				for (; col < ncols; ++col)
+				{
+					size_t cell = row * ncols + col;
+					for (size_t i = cells[cell]; i < cells[cell + 1]; ++i)
+					{
+						const Edge& edge = edges[edge_ids[i]];
+						if (!edge.fill) continue;
+
+						const Point& a = edge.a, &b = edge.b;
+						if ((a.y > point.y) == (b.y > point.y)) continue;
+
+						coord x = a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y);
+						x = std::max(std::min(a.x, b.x), std::min(x, std::max(a.x, b.x)));
+						if (x > point.x && get_col(x) == col)
+							odd = !odd;
+					}
+				}
+				return odd;
+			}
+
+			bool is_near_outline (const Point& point, coord distance) const
+			{
+				if (edges.empty() || !is_in_bounds(point, distance)) return false;
+
+				int row_min = get_row(point.y - distance);
+				int row_max = get_row(point.y + distance);
+				int col_min = get_col(point.x - distance);
+				int col_max = get_col(point.x + distance);
+				coord distance2 = distance * distance;
+				for (int row = row_min; row <= row_max; ++row)
+				{
+					for (int col = col_min; col <= col_max; ++col)
+					{
+						size_t cell = row * ncols + col;
+						for (size_t i = cells[cell]; i < cells[cell + 1]; ++i)
+						{
+							const Edge& edge = edges[edge_ids[i]];
+							if (get_distance2(point, edge.a, edge.b) <= distance2)
+								return true;
+						}
+					}
+				}
+				return false;
+			}
+
+		private:
+
+			struct Edge
+			{
+
+				Point a, b;
+
+				bool fill;
+
+			};// Edge
+
+			std::vector<Edge> edges;
+
+			coord left, top, cell_width, cell_height;
+
+			int ncols, nrows;
+
+			// edge_ids[cells[i]] to edge_ids[cells[i + 1]] are the edges that
+			// overlap the cell i.
+			std::vector<size_t> cells, edge_ids;
+
+			void add_edges (const Polyline& polyline)
+			{
+				size_t size = polyline.size();
+				if (size < 2) return;
+
+				// outlines to fill are closed even if they are not loops.
+				bool fill  = (polyline.fill() || polyline.hole()) && size >= 3;
+				bool close = polyline.loop() || fill;
+
+				const Point* points = polyline.points();
+				for (size_t i = 0; i + 1 < size; ++i)
+					edges.emplace_back(Edge {points[i], points[i + 1], fill});
+				if (close)
+					edges.emplace_back(Edge {points[size - 1], points[0], fill});
+			}
+
+			void build ()
+			{
+				coord right = left = edges[0].a.x, bottom = top = edges[0].a.y;
+				for (const auto& edge : edges)
+				{
+					left   = std::min(left,   std::min(edge.a.x, edge.b.x));
+					top    = std::min(top,    std::min(edge.a.y, edge.b.y));
+					right  = std::max(right,  std::max(edge.a.x, edge.b.x));
+					bottom = std::max(bottom, std::max(edge.a.y, edge.b.y));
+				}
+
+				// about one edge per cell for the edges spread evenly.
+				int n       = (int) sqrt((double) edges.size());
+				ncols       = nrows = std::max(1, std::min(n, 256));
+				cell_width  = std::max<coord>((right  - left) / ncols, 1e-6);
+				cell_height = std::max<coord>((bottom - top)  / nrows, 1e-6);
+
+				cells.assign(ncols * nrows + 1, 0);
+				each_cell([&](size_t cell, size_t) {++cells[cell + 1];});
+				for (size_t i = 1; i < cells.size(); ++i)
+					cells[i] += cells[i - 1];
+
+				std::vector<size_t> ends(cells.begin(), cells.end() - 1);
+				edge_ids.resize(cells.back());
+				each_cell([&](size_t cell, size_t id) {edge_ids[ends[cell]++] = id;});
+			}
+
+			template <typename FUN>
+			void each_cell (FUN fun) const
+			{
+				for (size_t id = 0; id < edges.size(); ++id)
+				{
+					const Edge& edge = edges[id];
+					int row_min = get_row(std::min(edge.a.y, edge.b.y));
+					int row_max = get_row(std::max(edge.a.y, edge.b.y));
+					int col_min = get_col(std::min(edge.a.x, edge.b.x));
+					int col_max = get_col(std::max(edge.a.x, edge.b.x));
+					for (int row = row_min; row <= row_max; ++row)
+					{
+						for (int col = col_min; col <= col_max; ++col)
+							fun(row * ncols + col, id);
+					}
+				}
+			}
+
+			bool is_in_bounds (const Point& point, coord margin) const
+			{
+				return
+					left - margin <= point.x && point.x <= left + cell_width  * ncols + margin &&
+					top  - margin <= point.y && point.y <= top  + cell_height * nrows + margin;
+			}
+
+			int get_col (coord x) const
+			{
+				return clip_index((x - left) / cell_width, ncols);
+			}
+
+			int get_row (coord y) const
+			{
+				return clip_index((y - top) / cell_height, nrows);
+			}
+
+			static int clip_index (coord value, int size)
+			{
+				if (value <= 0) return 0;
+				return std::min((int) value, size - 1);
+			}
+
+			static coord get_distance2 (const Point& p, const Point& a, const Point& b)
+			{
+				Point ab = b - a, ap = p - a;
+				coord len2 = ab.x * ab.x + ab.y * ab.y;
+				coord t    = len2 > 0 ? (ap.x * ab.x + ap.y * ab.y) / len2 : 0;
+				t          = std::max<coord>(0, std::min<coord>(t, 1));
+
+				coord dx = ap.x - ab.x * t, dy = ap.y - ab.y * t;
+				return dx * dx + dy * dy;
+			}
+
+	};// EdgeGrid
+
+
 	struct Polygon::Data
 	{
 
@@ -263,6 +940,10 @@ namespace Rays
 
 		mutable std::unique_ptr<Triangles> ptriangles;
 
+		mutable std::unique_ptr<StrokeTriangles> pstroke;
+
+		mutable std::unique_ptr<EdgeGrid> pgrid;
+
 		virtual ~Data ()
 		{
 		}
@@ -294,6 +975,12 @@ namespace Rays
 			polylines.emplace_back(polyline);
 		}
 
+		const EdgeGrid& grid () const
+		{
+			if (!pgrid) pgrid.reset(new EdgeGrid(polylines));
+			return *pgrid;
+		}
+
 		bool triangulate (TrianglePointList* triangles) const
 		{
 			triangles->clear();
@@ -324,31 +1011,10 @@ namespace Rays
 
 			Triangles& triangles () const
 			{
-				if (!ptriangles)
-				{
-					ptriangles.reset(new Triangles(count_points_for_triangulation()));
-					for (const auto& polyline : polylines)
-						ptriangles->append(polyline);
-				}
+				if (!ptriangles) ptriangles.reset(new Triangles(polylines));
 				return *ptriangles;
 			}
 
-			size_t count_points_for_triangulation () const
-			{
-				size_t count = 0;
-				for (const auto& polyline : polylines)
-				{
-					if (can_triangulate(polyline))
-						count += polyline.size();
-				}
-				return count;
-			}
-
-			bool can_triangulate (const Polyline& polyline) const
-			{
-				return (polyline.fill() || polyline.hole()) && polyline.size() >= 3;
-			}
-
 			void stroke_with_width (
 				const Polygon& polygon, Painter* painter,
 				const Color& color, coord stroke_width, float stroke_outset) const
@@ -357,10 +1023,51 @@ namespace Rays
 
 				if (!polygon || polygon.empty()) return;
 
+				if (can_extrude_stroke(painter, stroke_outset))
+				{
+					for (const auto& polyline : polylines)
+					{
+						Painter_extrude_stroke(
+							painter, color, &polyline[0], polyline.size(), polyline.loop());
+					}
+					return;
+				}
+
 				CapType cap   = painter->stroke_cap();
 				JoinType join = painter->stroke_join();
 				coord ml      = painter->miter_limit();
 
+				// the triangles of the stroke are made only when the stroke
+				// parameters change.
+				if (!pstroke || !pstroke->match(stroke_width, stroke_outset, cap, join, ml))
+				{
+					pstroke.reset(
+						new StrokeTriangles(stroke_width, stroke_outset, cap, join, ml));
+					make_stroke(pstroke.get(), polygon);
+				}
+
+				pstroke->draw(painter, color);
+			}
+
+			bool can_extrude_stroke (Painter* painter, float stroke_outset) const
+			{
+				if (!Painter_can_extrude_stroke(painter))
+					return false;
+
+				// loops are extruded along the centerlines only, the others are
+				// expanded by clipper before stroking.
+				for (const auto& polyline : polylines)
+				{
+					if (polyline.loop() && stroke_outset != 0.5)
+						return false;
+				}
+				return true;
+			}
+
+			void make_stroke (StrokeTriangles* stroke, const Polygon& polygon) const
+			{
+				assert(stroke && stroke->width > 0);
+
 				bool has_loop = false;
 				for (const auto& polyline : polygon)
 				{
@@ -369,38 +1076,42 @@ namespace Rays
 						has_loop = true;
 						continue;
 					}
-					stroke_polyline(polyline, painter, color, stroke_width, cap, join, ml);
+					stroke_polyline(stroke, polyline);
 				}
 
 				if (!has_loop) return;
 
-				coord inset = (-0.5 + stroke_outset) * stroke_width;
+				// loops are stroked along the outlines moved by the outset, which
+				// still needs clipper.
+				coord inset = (-0.5 + stroke->outset) * stroke->width;
 				Polygon outline;
 				if (inset == 0)
 					outline = polygon;
-				else if (!polygon.expand(&outline, inset, cap, join, ml))
+				else if (!polygon.expand(
+					&outline, inset, stroke->cap, stroke->join, stroke->miter_limit))
+				{
 					return;
+				}
 
 				for (const auto& polyline : outline)
 				{
 					if (polyline.loop())
-						stroke_polyline(polyline, painter, color, stroke_width, cap, join, ml);
+						stroke_polyline(stroke, polyline);
 				}
 			}
 
-			void stroke_polyline (
-				const Polyline& polyline, Painter* painter,
-				const Color& color, coord stroke_width,
-				CapType cap, JoinType join, coord miter_limit) const
+			void stroke_polyline (StrokeTriangles* stroke, const Polyline& polyline) const
 			{
-				assert(stroke_width > 0);
+				assert(stroke);
 
 				if (!polyline || polyline.empty())
 					return;
 
-				Polygon stroke;
-				if (polyline.expand(&stroke, stroke_width / 2, cap, join, miter_limit))
-					Polygon_fill(stroke, painter, color);
+				bool overlap = Polyline_stroke(
+					&stroke->points, &stroke->indices, polyline,
+					stroke->width, stroke->cap, stroke->join, stroke->miter_limit);
+				if (overlap)
+					stroke->overlapping_centerlines.emplace_back(polyline);
 			}
 
 			void stroke_without_width (Painter* painter, const Color& color) const
@@ -472,7 +1183,8 @@ namespace Rays
 
 	static void
 	add_polygon_to_clipper (
-		clip::Clipper* clipper, const Polygon& polygon, clip::PolyType type)
+		clip::Clipper* clipper, const Polygon& polygon, clip::PolyType type,
+		bool normalize_orientation = false)
 	{
 		assert(clipper);
 
@@ -484,6 +1196,15 @@ namespace Rays
 			Polyline_get_path(&path, polyline, polyline.hole());
 			if (path.empty()) continue;
 
+			// outlines wind one way and holes the other, so that the
+			// polygons can be clipped together by the non-zero rule.
+			if (
+				normalize_orientation && polyline.loop() &&
+				clip::Orientation(path) == polyline.hole())
+			{
+				clip::ReversePath(path);
+			}
+
 			clipper->AddPath(path, type, polyline.loop());
 		}
 	}
@@ -553,14 +1274,16 @@ namespace Rays
 	}
 
 	static bool
-	append_outline (Polygon* polygon, const clip::PolyNode& node)
+	append_outline (
+		Polygon* polygon, const std::shared_ptr<PolylineBuffer>& buffer,
+		const clip::PolyNode& node)
 	{
 		assert(polygon);
 
 		if (node.Contour.empty() || node.IsHole())
 			return false;
 
-		Polyline polyline = Polyline_create(node.Contour, !node.IsOpen());
+		Polyline polyline = Polyline_create(buffer, node.Contour, !node.IsOpen());
 		if (!polyline)
 			return false;
 
@@ -569,7 +1292,9 @@ namespace Rays
 	}
 
 	static void
-	append_hole (Polygon* polygon, const clip::PolyNode& node)
+	append_hole (
+		Polygon* polygon, const std::shared_ptr<PolylineBuffer>& buffer,
+		const clip::PolyNode& node)
 	{
 		assert(polygon);
 
@@ -578,7 +1303,8 @@ namespace Rays
 			if (!child->IsHole())
 				return;
 
-			Polyline polyline = Polyline_create(child->Contour, !child->IsOpen(), true);
+			Polyline polyline =
+				Polyline_create(buffer, child->Contour, !child->IsOpen(), true);
 			if (!polyline)
 				continue;
 
@@ -587,15 +1313,38 @@ namespace Rays
 	}
 
 	static void
-	get_polygon (Polygon* polygon, const clip::PolyNode& node)
+	append_nodes (
+		Polygon* polygon, const std::shared_ptr<PolylineBuffer>& buffer,
+		const clip::PolyNode& node)
 	{
 		assert(polygon);
 
-		if (append_outline(polygon, node))
-			append_hole(polygon, node);
+		if (append_outline(polygon, buffer, node))
+			append_hole(polygon, buffer, node);
 
 		for (const auto* child : node.Childs)
-			get_polygon(polygon, *child);
+			append_nodes(polygon, buffer, *child);
+	}
+
+	static size_t
+	count_points (const clip::PolyNode& node)
+	{
+		size_t count = node.Contour.size();
+		for (const auto* child : node.Childs)
+			count += count_points(*child);
+		return count;
+	}
+
+	static void
+	get_polygon (Polygon* polygon, const clip::PolyNode& tree)
+	{
+		assert(polygon);
+
+		// all the rings of the result share one buffer.
+		auto buffer = std::make_shared<PolylineBuffer>();
+		buffer->points.reserve(count_points(tree));
+
+		append_nodes(polygon, buffer, tree);
 	}
 
 	static Polygon
@@ -618,6 +1367,26 @@ namespace Rays
 		return result;
 	}
 
+	static Polygon
+	reduce_polygons (
+		const Polygon* polygons, size_t size, clip::ClipType type)
+	{
+		assert(polygons && size > 0);
+
+		if (size == 1) return polygons[0];
+
+		size_t half  = size / 2;
+		Polygon head = reduce_polygons(polygons, half, type);
+		if (type == clip::ctIntersection && head.empty())
+			return head;
+
+		Polygon tail = reduce_polygons(polygons + half, size - half, type);
+		if (head.self == tail.self)
+			return head;
+
+		return clip_polygons(head, tail, type);
+	}
+
 	static bool
 	expand_polygon (
 		Polygon* result, const Polygon& polygon,
@@ -1504,6 +2273,30 @@ namespace Rays
 		return polygon.self->triangulate(triangles);
 	}
 
+	void
+	Polygon_get_ellipse_points (
+		std::vector<Point>* points,
+		coord x, coord y, coord width, coord height, uint nsegment)
+	{
+		assert(points);
+
+		nsegment = get_nsegment_for_angle(nsegment, 3, 0, 360);
+
+		float radian_to = Xot::deg2rad(360);
+
+		points->clear();
+		points->reserve(nsegment);
+		for (uint seg = 0; seg < nsegment; ++seg)
+		{
+			// the same as EllipseData::make_ellipse_point() from 0 degree
+			float pos    = (float) seg / (float) nsegment;
+			float radian = radian_to * pos;
+			float cos_   = (cos(radian)  + 1) / 2.;
+			float sin_   = (-sin(radian) + 1) / 2.;
+			points->emplace_back(x + width * cos_, y + height * sin_);
+		}
+	}
+
 
 	Polygon::Polygon ()
 	{
@@ -1561,6 +2354,34 @@ namespace Rays
 		return self->bounds();
 	}
 
+	bool
+	Polygon::contains (const Point& point) const
+	{
+		return self->grid().contains(point);
+	}
+
+	void
+	Polygon::contains (bool* results, const Point* points, size_t size) const
+	{
+		if ((!results || !points) && size > 0)
+			argument_error(__FILE__, __LINE__);
+
+		if (size == 0) return;
+
+		const EdgeGrid& grid = self->grid();
+		for (size_t i = 0; i < size; ++i)
+			results[i] = grid.contains(points[i]);
+	}
+
+	bool
+	Polygon::is_near_outline (const Point& point, coord distance) const
+	{
+		if (distance < 0)
+			argument_error(__FILE__, __LINE__);
+
+		return self->grid().is_near_outline(point, distance);
+	}
+
 	size_t
 	Polygon::size () const
 	{
@@ -1625,6 +2446,60 @@ namespace Rays
 		return self->triangulate(triangles);
 	}
 
+	Polygon
+	Polygon::unite (const Polygon* polygons, size_t size)
+	{
+		if (!polygons && size > 0)
+			argument_error(__FILE__, __LINE__);
+
+		if (size == 0) return Polygon();
+		if (size == 1) return polygons[0];
+
+		// all the polygons go into one clipper pass. with the orientation
+		// normalized, the non-zero rule fills the area covered by any of them.
+		clip::Clipper c;
+		c.StrictlySimple(true);
+
+		for (size_t i = 0; i < size; ++i)
+			add_polygon_to_clipper(&c, polygons[i], clip::ptSubject, true);
+
+		clip::PolyTree tree;
+		c.Execute(clip::ctUnion, tree, clip::pftNonZero, clip::pftNonZero);
+		assert(tree.Contour.empty());
+
+		Polygon result;
+		get_polygon(&result, tree);
+		return result;
+	}
+
+	Polygon
+	Polygon::intersect (const Polygon* polygons, size_t size)
+	{
+		if (!polygons && size > 0)
+			argument_error(__FILE__, __LINE__);
+
+		if (size == 0) return Polygon();
+
+		// intersection can not be done in one clipper pass, so the chunks
+		// are reduced on the worker pool and then the chunk results.
+		size_t nchunks = std::min(
+			WorkerPool_get_concurrency(), size / PARALLEL_REDUCE_POLYGONS_MIN);
+		if (nchunks < 2)
+			return reduce_polygons(polygons, size, clip::ctIntersection);
+
+		std::vector<Polygon> results(nchunks);
+		WorkerPool_run(nchunks, [&](size_t i)
+		{
+			size_t begin = size *  i      / nchunks;
+			size_t end   = size * (i + 1) / nchunks;
+			results[i]   = reduce_polygons(
+				polygons + begin, end - begin, clip::ctIntersection);
+		});
+
+		return reduce_polygons(
+			&results[0], results.size(), clip::ctIntersection);
+	}
+
 	Polygon
 	operator + (const Polygon& lhs, const Polyline& rhs)
 	{
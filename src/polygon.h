@@ -25,6 +25,13 @@ namespace Rays
 	bool Polygon_triangulate (
 		Polygon::TrianglePointList* triangles, const Polygon& polygon);
 
+	// Returns the outline that create_ellipse() makes for the bounds.
+	// The outline for the unit square reproduces the outline of any
+	// ellipse by scaling the points.
+	void Polygon_get_ellipse_points (
+		std::vector<Point>* points,
+		coord x, coord y, coord width, coord height, uint nsegment);
+
 
 }// Rays
 
@@ -1,7 +1,11 @@
 #include "polyline.h"
 
 
+#include <math.h>
+#include <assert.h>
 #include <memory>
+#include <vector>
+#include <algorithm>
 #include "rays/color.h"
 #include "rays/debug.h"
 
@@ -16,89 +20,116 @@ namespace Rays
 	struct Polyline::Data
 	{
 
-		typedef std::vector<Color>  ColorList;
+		// arrays of the caller that the polyline refers to without owning.
+		struct View
+		{
+
+			const Point* points;
+
+			const Color* colors;
 
-		typedef std::vector<Coord3> TexCoordList;
+			const Coord3* texcoords;
 
-		PointList points;
+		};// View
 
-		std::unique_ptr<ColorList>    pcolors;
+		std::shared_ptr<PolylineBuffer> buffer;
 
-		std::unique_ptr<TexCoordList> ptexcoords;
+		std::unique_ptr<View> pview;
 
+		size_t offset = 0, size = 0;
+
+		// holes keep the order of the points given, the flag tells the
+		// orientation instead.
 		bool loop = false, fill = false, hole = false;
 
+		bool has_colors = false, has_texcoords = false;
+
 		void reset (
 			const auto* points_, const Color* colors_, const Coord3* texcoords_,
 			size_t size_, bool loop_, bool fill_, bool hole_,
 			auto to_point_fun)
 		{
-			ColorList* colors       = colors_    ? &this->colors()    : NULL;
-			TexCoordList* texcoords = texcoords_ ? &this->texcoords() : NULL;
-			int size                = (int) size_;
-
-			loop = loop_;
-			fill = fill_;
-			hole = hole_;
-			if (!is_valid())
-				argument_error(__FILE__, __LINE__, "hole polyline must be looped");
-
-			points.clear();
-			points.reserve(size);
-			if (hole)
-			{
-				for (int i = size - 1; i >= 0; --i)
-					points.emplace_back(to_point_fun(points_[i]));
-			}
-			else
-			{
-				for (int i = 0; i < size; ++i)
-					points.emplace_back(to_point_fun(points_[i]));
-			}
+			reset(
+				std::make_shared<PolylineBuffer>(),
+				points_, colors_, texcoords_, size_, loop_, fill_, hole_,
+				to_point_fun);
+		}
+
+		// appends the points to the buffer that may be shared with other
+		// polylines, and refers to the range of them.
+		void reset (
+			const std::shared_ptr<PolylineBuffer>& buffer_,
+			const auto* points_, const Color* colors_, const Coord3* texcoords_,
+			size_t size_, bool loop_, bool fill_, bool hole_,
+			auto to_point_fun)
+		{
+			assert(buffer_);
+
+			set_flags(loop_, fill_, hole_, colors_, texcoords_);
 
-			if (colors)
+			buffer = buffer_;
+			offset = buffer->points.size();
+			size   = size_;
+
+			auto& points = buffer->points;
+			points.reserve(offset + size);
+			for (size_t i = 0; i < size; ++i)
+				points.emplace_back(to_point_fun(points_[i]));
+
+			if (colors_)
 			{
-				colors->clear();
-				colors->reserve(size);
-				if (hole)
-				{
-					for (int i = size - 1; i >= 0; --i)
-						colors->emplace_back(colors_[i]);
-				}
-				else
-				{
-					for (int i = 0; i < size; ++i)
-						colors->emplace_back(colors_[i]);
-				}
+				buffer->colors.resize(offset);
+				buffer->colors.insert(buffer->colors.end(), colors_, colors_ + size);
 			}
 
-			if (texcoords)
+			if (texcoords_)
 			{
-				texcoords->clear();
-				texcoords->reserve(size);
-				if (hole)
-				{
-					for (int i = size - 1; i >= 0; --i)
-						texcoords->emplace_back(texcoords_[i]);
-				}
-				else
-				{
-					for (int i = 0; i < size; ++i)
-						texcoords->emplace_back(texcoords_[i]);
-				}
+				buffer->texcoords.resize(offset);
+				buffer->texcoords.insert(
+					buffer->texcoords.end(), texcoords_, texcoords_ + size);
 			}
 		}
 
-		ColorList& colors ()
+		void reset (PointList&& points_, bool loop_, bool fill_, bool hole_)
+		{
+			set_flags(loop_, fill_, hole_, false, false);
+
+			buffer = std::make_shared<PolylineBuffer>();
+			buffer->points.swap(points_);
+			offset = 0;
+			size   = buffer->points.size();
+		}
+
+		void reset_view (
+			const Point* points_, const Color* colors_, const Coord3* texcoords_,
+			size_t size_, bool loop_, bool fill_, bool hole_)
+		{
+			if (!points_ && size_ > 0)
+				argument_error(__FILE__, __LINE__);
+
+			set_flags(loop_, fill_, hole_, colors_, texcoords_);
+
+			pview.reset(new View {points_, colors_, texcoords_});
+			offset = 0;
+			size   = size_;
+		}
+
+		const Point* points () const
 		{
-			if (!pcolors) pcolors.reset(new ColorList());
-			return *pcolors;
+			if (size == 0) return NULL;
+			return pview ? pview->points : &buffer->points[offset];
 		}
 
-		TexCoordList& texcoords ()
+		const Color* colors () const
 		{
-			if (!ptexcoords) ptexcoords.reset(new TexCoordList());
-			return *ptexcoords;
+			if (size == 0 || !has_colors) return NULL;
+			return pview ? pview->colors : &buffer->colors[offset];
+		}
+
+		const Coord3* texcoords () const
+		{
+			if (size == 0 || !has_texcoords) return NULL;
+			return pview ? pview->texcoords : &buffer->texcoords[offset];
 		}
 
 		bool is_valid () const
@@ -107,33 +138,53 @@ namespace Rays
 		}
 
 		private:
-#if 0
-			void reset_values (size_t size_, bool hole, auto fun)
-			{
-				int size = (int) size_;
 
-				if (hole)
-					for (int i = size - 1; i >= 0;   --i) fun((size_t) i);
-				else
-					for (int i = 0;        i < size; ++i) fun((size_t) i);
+			void set_flags (
+				bool loop_, bool fill_, bool hole_, bool colors_, bool texcoords_)
+			{
+				loop          = loop_;
+				fill          = fill_;
+				hole          = hole_;
+				has_colors    = colors_;
+				has_texcoords = texcoords_;
+				if (!is_valid())
+					argument_error(__FILE__, __LINE__, "hole polyline must be looped");
 			}
-#endif
+
 	};// Polyline::Data
 
 
 	Polyline
 	Polyline_create (const Path& path, bool loop, bool hole)
 	{
+		return Polyline_create(std::make_shared<PolylineBuffer>(), path, loop, hole);
+	}
+
+	Polyline
+	Polyline_create (
+		const std::shared_ptr<PolylineBuffer>& buffer,
+		const Path& path, bool loop, bool hole)
+	{
+		if (!buffer)
+			argument_error(__FILE__, __LINE__);
+
 		Path cleaned;
 		ClipperLib::CleanPolygon(path, cleaned);
 
 		Polyline pl;
 		pl.self->reset(
-			&cleaned[0], NULL, NULL, cleaned.size(), loop, loop, hole,
+			buffer, cleaned.data(), NULL, NULL, cleaned.size(), loop, loop, hole,
 			[](const IntPoint& point) {return from_clipper(point);});
 		return pl;
 	}
 
+	const std::shared_ptr<PolylineBuffer>&
+	Polyline_get_buffer (const Polyline& polyline, size_t* offset)
+	{
+		if (offset) *offset = polyline.self->offset;
+		return polyline.self->buffer;
+	}
+
 	template <typename I>
 	static void
 	reset_path (Path* path, I begin, I end)
@@ -146,11 +197,366 @@ namespace Rays
 	void
 	Polyline_get_path (Path* path, const Polyline& polyline, bool hole)
 	{
-		const auto& points = polyline.self->points;
-		if (hole)
-			reset_path(path, points.rbegin(), points.rend());
+		typedef std::reverse_iterator<Polyline::const_iterator> RIt;
+
+		// the points of a hole are in the order given, so they are reversed
+		// only when the path wants the other orientation.
+		if (hole != polyline.hole())
+			reset_path(path, RIt(polyline.end()), RIt(polyline.begin()));
 		else
-			reset_path(path, points. begin(), points. end());
+			reset_path(path, polyline.begin(), polyline.end());
+	}
+
+
+	// the largest distance between the round joins or caps and their arcs
+	static const coord STROKE_ARC_TOLERANCE = 0.25;
+
+	struct Stroker
+	{
+
+		std::vector<Point>* points;
+
+		std::vector<uint>*  indices;
+
+		coord width;// half of the stroke width
+
+		CapType cap;
+
+		JoinType join;
+
+		coord miter_limit;
+
+		uint add (const Point& point)
+		{
+			points->emplace_back(point);
+			return (uint) points->size() - 1;
+		}
+
+		void add_triangle (uint a, uint b, uint c)
+		{
+			indices->push_back(a);
+			indices->push_back(b);
+			indices->push_back(c);
+		}
+
+		void add_triangle (const Point& a, const Point& b, const Point& c)
+		{
+			add_triangle(add(a), add(b), add(c));
+		}
+
+		// adds the fan from 'from' that covers the arc around 'center' which
+		// rotates the radius 'from - center' by 'angle'.
+		void add_arc (const Point& center, const Point& from, float angle)
+		{
+			int nsegment = get_arc_segments(angle);
+			float c      = cos(angle / nsegment);
+			float s      = sin(angle / nsegment);
+
+			Point radius = from - center;
+			uint first   = add(from), prev = first;
+			for (int i = 1; i <= nsegment; ++i)
+			{
+				radius.reset(radius.x * c - radius.y * s, radius.x * s + radius.y * c);
+				uint index = add(center + radius);
+				if (i >= 2) add_triangle(first, prev, index);
+				prev = index;
+			}
+		}
+
+		int get_arc_segments (float angle) const
+		{
+			float step =
+				width > STROKE_ARC_TOLERANCE
+					? 2 * acos(1 - STROKE_ARC_TOLERANCE / width)
+					: M_PI / 2;
+			return std::max((int) ceil(fabs(angle) / step), 2);
+		}
+
+	};// Stroker
+
+	static inline Point
+	get_left_normal (const Point& dir)
+	{
+		return Point(-dir.y, dir.x);
+	}
+
+	static inline coord
+	get_cross (const Point& a, const Point& b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+
+	struct StrokeJoint
+	{
+
+		// outer side of the turn along the left normals, or 0 if straight
+		coord side = 0;
+
+		// the point where the inner edges of the segments meet
+		bool has_inner = false;
+
+		Point inner;
+
+	};// StrokeJoint
+
+	static void
+	setup_joint (
+		StrokeJoint* joint, coord width, const Point& point,
+		const Point& dir1, coord len1, const Point& dir2, coord len2)
+	{
+		coord cross = get_cross(dir1, dir2);
+		coord dot   = Rays::dot(dir1, dir2);
+		if (fabs(cross) < 1e-6 && dot > 0)
+			return;
+
+		joint->side = cross > 0 ? -1 : +1;
+
+		float half = atan2(fabs(cross), dot) / 2;
+		if (half >= M_PI / 2 - 1e-3)
+			return;
+
+		// the segments share the inner point only if both of them are long
+		// enough for the joints at their both ends.
+		coord along = width * tan(half);
+		if (along * 2 > len1 || along * 2 > len2)
+			return;
+
+		Point bisector = get_left_normal(dir1) + get_left_normal(dir2);
+		bisector      *= 1 / bisector.length();
+		joint->has_inner = true;
+		joint->inner     = point - bisector * (joint->side * width / cos(half));
+	}
+
+	static void
+	add_joint (
+		Stroker* stroker, const StrokeJoint& joint, const Point& point,
+		const Point& dir1, const Point& dir2)
+	{
+		if (joint.side == 0) return;
+
+		coord width = stroker->width;
+		Point c1    = point + get_left_normal(dir1) * (joint.side * width);
+		Point c2    = point + get_left_normal(dir2) * (joint.side * width);
+		stroker->add_triangle(joint.has_inner ? joint.inner : point, c1, c2);
+
+		coord cross = get_cross(dir1, dir2);
+		float angle = atan2(fabs(cross), Rays::dot(dir1, dir2));
+		float half  = angle / 2;
+
+		JoinType join = stroker->join;
+		if (join == JOIN_MITER && cos(half) * stroker->miter_limit < 1)
+			join = JOIN_SQUARE;// same as clipper does over the limit
+
+		switch (join)
+		{
+			case JOIN_MITER:
+			{
+				Point bisector = get_left_normal(dir1) + get_left_normal(dir2);
+				bisector      *= 1 / bisector.length();
+				stroker->add_triangle(
+					c1, point + bisector * (joint.side * width / cos(half)), c2);
+				break;
+			}
+
+			case JOIN_ROUND:
+				stroker->add_arc(point, c1, joint.side < 0 ? angle : -angle);
+				break;
+
+			case JOIN_SQUARE:
+			default:
+			{
+				coord t = width * tan(angle / 4);
+				uint i1 = stroker->add(c1);
+				uint i2 = stroker->add(c1 + dir1 * t);
+				uint i3 = stroker->add(c2 - dir2 * t);
+				uint i4 = stroker->add(c2);
+				stroker->add_triangle(i1, i2, i3);
+				stroker->add_triangle(i1, i3, i4);
+				break;
+			}
+		}
+	}
+
+	static void
+	add_point_cap (Stroker* stroker, const Point& point)
+	{
+		coord w = stroker->width;
+		switch (stroker->cap)
+		{
+			case CAP_ROUND:
+				stroker->add_arc(point, point + Point(w, 0), M_PI * 2);
+				break;
+
+			case CAP_SQUARE:
+			{
+				uint i1 = stroker->add(point + Point(-w, -w));
+				uint i2 = stroker->add(point + Point(+w, -w));
+				uint i3 = stroker->add(point + Point(+w, +w));
+				uint i4 = stroker->add(point + Point(-w, +w));
+				stroker->add_triangle(i1, i2, i3);
+				stroker->add_triangle(i1, i3, i4);
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+
+	// whether the triangles of segments that are not next to each other may
+	// overlap, which is checked on their bounds grown by the reach of the
+	// joins and caps.
+	static bool
+	may_overlap_segments (
+		const std::vector<Point>& centers, size_t nsegments, bool loop,
+		coord reach)
+	{
+		if (nsegments < 3) return false;
+
+		struct Bounds {coord left, top, right, bottom; size_t index;};
+
+		size_t size = centers.size();
+		std::vector<Bounds> bounds(nsegments);
+		for (size_t i = 0; i < nsegments; ++i)
+		{
+			const Point& a = centers[i];
+			const Point& b = centers[(i + 1) % size];
+			bounds[i] = {
+				std::min(a.x, b.x) - reach, std::min(a.y, b.y) - reach,
+				std::max(a.x, b.x) + reach, std::max(a.y, b.y) + reach,
+				i};
+		}
+		std::sort(
+			bounds.begin(), bounds.end(),
+			[](const Bounds& a, const Bounds& b) {return a.left < b.left;});
+
+		auto adjacent = [&](size_t a, size_t b)
+		{
+			size_t d = a > b ? a - b : b - a;
+			return d <= 1 || (loop && d == nsegments - 1);
+		};
+
+		// sweeps along x, comparing each segment with the ones whose bounds
+		// are still open.
+		for (size_t i = 0; i < nsegments; ++i)
+		{
+			const Bounds& a = bounds[i];
+			for (size_t j = i + 1; j < nsegments && bounds[j].left <= a.right; ++j)
+			{
+				const Bounds& b = bounds[j];
+				if (b.top > a.bottom || a.top > b.bottom) continue;
+				if (!adjacent(a.index, b.index)) return true;
+			}
+		}
+		return false;
+	}
+
+	bool
+	Polyline_stroke (
+		std::vector<Point>* points, std::vector<uint>* indices,
+		const Polyline& polyline,
+		coord width, CapType cap, JoinType join, coord miter_limit)
+	{
+		if (!points || !indices)
+			argument_error(__FILE__, __LINE__);
+
+		if (width <= 0 || polyline.empty()) return false;
+
+		Stroker stroker {points, indices, width / 2, cap, join, miter_limit};
+		bool loop = polyline.loop();
+
+		// segments without length have no direction to stroke
+		std::vector<Point> centers;
+		centers.reserve(polyline.size());
+		for (const auto& point : polyline)
+		{
+			if (centers.empty() || centers.back() != point)
+				centers.emplace_back(point);
+		}
+		if (loop && centers.size() >= 2 && centers.front() == centers.back())
+			centers.pop_back();
+
+		size_t size = centers.size();
+		if (size == 1)
+		{
+			if (!loop) add_point_cap(&stroker, centers[0]);
+			return false;
+		}
+
+		size_t nsegments = loop ? size : size - 1;
+		std::vector<Point> dirs(nsegments);
+		std::vector<coord> lengths(nsegments);
+		for (size_t i = 0; i < nsegments; ++i)
+		{
+			Point d    = centers[(i + 1) % size] - centers[i];
+			lengths[i] = d.length();
+			dirs[i]    = d / lengths[i];
+		}
+
+		// joint[i] is at centers[i], between the segments i - 1 and i
+		bool overlap = false;
+		std::vector<StrokeJoint> joints(size);
+		for (size_t i = loop ? 0 : 1; i < (loop ? size : size - 1); ++i)
+		{
+			size_t prev = (i + nsegments - 1) % nsegments;
+			StrokeJoint& joint = joints[i];
+			setup_joint(
+				&joint, stroker.width, centers[i],
+				dirs[prev], lengths[prev], dirs[i], lengths[i]);
+
+			// without the inner point, the segments overlap at the joint.
+			if (joint.side != 0 && !joint.has_inner)
+				overlap = true;
+		}
+
+		// miters reach out up to the limit, square joins and caps by sqrt(2).
+		coord reach = stroker.width * std::max<coord>(
+			join == JOIN_MITER ? miter_limit : 1, 1.5);
+		if (!overlap)
+			overlap = may_overlap_segments(centers, nsegments, loop, reach);
+
+		coord w = stroker.width;
+		for (size_t i = 0; i < nsegments; ++i)
+		{
+			size_t next = (i + 1) % size;
+			Point a = centers[i], b = centers[next];
+			if (!loop && cap == CAP_SQUARE)
+			{
+				if (i == 0)             a -= dirs[i] * w;
+				if (i == nsegments - 1) b += dirs[i] * w;
+			}
+
+			Point normal = get_left_normal(dirs[i]) * w;
+			Point al = a + normal, ar = a - normal;
+			Point bl = b + normal, br = b - normal;
+
+			// the inner side of the joints ends at the inner points
+			const StrokeJoint& ja = joints[i];
+			const StrokeJoint& jb = joints[next];
+			if (ja.has_inner) (ja.side > 0 ? ar : al) = ja.inner;
+			if (jb.has_inner) (jb.side > 0 ? br : bl) = jb.inner;
+
+			uint i1 = stroker.add(al), i2 = stroker.add(ar);
+			uint i3 = stroker.add(br), i4 = stroker.add(bl);
+			stroker.add_triangle(i1, i2, i3);
+			stroker.add_triangle(i1, i3, i4);
+		}
+
+		for (size_t i = loop ? 0 : 1; i < (loop ? size : size - 1); ++i)
+		{
+			size_t prev = (i + nsegments - 1) % nsegments;
+			add_joint(&stroker, joints[i], centers[i], dirs[prev], dirs[i]);
+		}
+
+		if (!loop && cap == CAP_ROUND)
+		{
+			const Point& first = centers.front();
+			const Point& last  = centers.back();
+			stroker.add_arc(first, first + get_left_normal(dirs.front()) * w,  M_PI);
+			stroker.add_arc(last,  last  + get_left_normal(dirs.back())  * w, -M_PI);
+		}
+
+		return overlap;
 	}
 
 
@@ -178,6 +584,11 @@ namespace Rays
 			[](const Point& p) {return p;});
 	}
 
+	Polyline::Polyline (PointList&& points, bool loop, bool fill, bool hole)
+	{
+		self->reset(std::move(points), loop, fill, hole);
+	}
+
 	Polyline::~Polyline ()
 	{
 	}
@@ -223,28 +634,25 @@ namespace Rays
 	const Point*
 	Polyline::points () const
 	{
-		const auto& v = self->points;
-		return !v.empty() ? &v[0] : NULL;
+		return self->points();
 	}
 
 	const Color*
 	Polyline::colors () const
 	{
-		const auto& pv = self->pcolors;
-		return pv && !pv->empty() ? &(*pv)[0] : NULL;
+		return self->colors();
 	}
 
 	const Coord3*
 	Polyline::texcoords () const
 	{
-		const auto& pv = self->ptexcoords;
-		return pv && !pv->empty() ? &(*pv)[0] : NULL;
+		return self->texcoords();
 	}
 
 	size_t
 	Polyline::size () const
 	{
-		return self->points.size();
+		return self->size;
 	}
 
 	bool
@@ -256,19 +664,30 @@ namespace Rays
 	Polyline::const_iterator
 	Polyline::begin () const
 	{
-		return self->points.begin();
+		return self->points();
 	}
 
 	Polyline::const_iterator
 	Polyline::end () const
 	{
-		return self->points.end();
+		return begin() + self->size;
 	}
 
 	const Point&
 	Polyline::operator [] (size_t index) const
 	{
-		return self->points[index];
+		return self->points()[index];
+	}
+
+	Polyline
+	Polyline::view (
+		const Point* points, size_t size, bool loop, bool fill,
+		const Color* colors, const Coord3* texcoords,
+		bool hole)
+	{
+		Polyline pl;
+		pl.self->reset_view(points, colors, texcoords, size, loop, fill, hole);
+		return pl;
 	}
 
 	Polyline::operator bool () const
@@ -5,8 +5,11 @@
 
 
 #include <float.h>
+#include <memory>
+#include <vector>
 #include <clipper.hpp>
 #include "rays/polyline.h"
+#include "rays/color.h"
 #include "rays/exception.h"
 
 
@@ -50,9 +53,33 @@ namespace Rays
 	}
 
 
+	// Contiguous storage that the polylines can share. Each polyline refers
+	// to its range of the points, and of the colors and texcoords if it has
+	// them, so the rings of a polygon do not need an allocation for each.
+	struct PolylineBuffer
+	{
+
+		Polyline::PointList points;
+
+		std::vector<Color>  colors;
+
+		std::vector<Coord3> texcoords;
+
+	};// PolylineBuffer
+
+
 	Polyline Polyline_create (
 		const ClipperLib::Path& path, bool loop, bool hole = false);
 
+	// Appends the path to the buffer and returns the polyline for its range.
+	Polyline Polyline_create (
+		const std::shared_ptr<PolylineBuffer>& buffer,
+		const ClipperLib::Path& path, bool loop, bool hole = false);
+
+	// Returns NULL for the polylines that view the arrays of the caller.
+	const std::shared_ptr<PolylineBuffer>& Polyline_get_buffer (
+		const Polyline& polyline, size_t* offset = NULL);
+
 	void Polyline_get_path (
 		ClipperLib::Path* path, const Polyline& polyline, bool hole = false);
 
@@ -60,6 +87,16 @@ namespace Rays
 		Polygon* result, const Polyline& polyline,
 		coord width, CapType cap, JoinType join, coord miter_limit);
 
+	// Appends the triangles that cover the stroke along the polyline, which
+	// are made on floats without offsetting the outline by clipper. Joins
+	// and caps are the same as Polyline_expand() makes, but the triangles
+	// may overlap each other where the polyline turns sharply on short
+	// segments or comes near itself. Returns true if they may overlap.
+	bool Polyline_stroke (
+		std::vector<Point>* points, std::vector<uint>* indices,
+		const Polyline& polyline,
+		coord width, CapType cap, JoinType join, coord miter_limit);
+
 
 }// Rays
 
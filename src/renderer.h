@@ -5,6 +5,7 @@
 
 
 #include "rays/defs.h"
+#include "rays/rays.h"
 
 
 namespace Rays
@@ -15,6 +16,8 @@ namespace Rays
 
 	void Renderer_fin ();
 
+	Context Renderer_get_current_context ();
+
 
 }// Rays
 
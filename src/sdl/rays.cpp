@@ -6,6 +6,8 @@
 #include "rays/exception.h"
 #include "rays/debug.h"
 #include "../renderer.h"
+#include "../texture_atlas.h"
+#include "../glyph_atlas.h"
 
 
 namespace Rays
@@ -43,6 +45,10 @@ namespace Rays
 		if (!global::initialized)
 			rays_error(__FILE__, __LINE__, "not initialized");
 
+		// the atlas pages are textures of the context that goes away.
+		TextureAtlas_clear();
+		GlyphAtlas_clear();
+
 		Renderer_fin();
 
 		//TTF_Quit();
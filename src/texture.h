@@ -66,6 +66,9 @@ namespace Rays
 	};// Texture
 
 
+	uint Texture_get_version (const Texture& texture);
+
+
 }// Rays
 
 
@@ -0,0 +1,304 @@
+#include "texture_atlas.h"
+
+
+#include <assert.h>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "rays/painter.h"
+#include "painter.h"
+#include "image.h"
+#include "texture.h"
+
+
+namespace Rays
+{
+
+
+	enum
+	{
+
+		PAGE_SIZE      = 1024,
+
+		PAGE_MAX       = 4,
+
+		IMAGE_SIZE_MAX = 256,
+
+		IMAGE_GAP      = 1
+
+	};
+
+
+	struct AtlasPage
+	{
+
+		Image image;
+
+		int x = 0, y = 0, row_height = 0;
+
+		AtlasPage (bool smooth)
+		:	image(PAGE_SIZE, PAGE_SIZE, RGBA, 1, smooth)
+		{
+		}
+
+		bool allocate (int* alloc_x, int* alloc_y, int width, int height)
+		{
+			assert(alloc_x && alloc_y);
+
+			if (x + width > PAGE_SIZE)
+			{
+				x          = 0;
+				y         += row_height + IMAGE_GAP;
+				row_height = 0;
+			}
+			if (y + height > PAGE_SIZE)
+				return false;
+
+			*alloc_x    = x;
+			*alloc_y    = y;
+			x          += width + IMAGE_GAP;
+			row_height  = std::max(row_height, height);
+			return true;
+		}
+
+	};// AtlasPage
+
+
+	struct AtlasSlot
+	{
+
+		AtlasPage* page = NULL;
+
+		int x = 0, y = 0, width = 0, height = 0;
+
+		bool drawn = false;
+
+	};// AtlasSlot
+
+
+	struct AtlasEntry
+	{
+
+		// does not keep the texture alive; an expired one means the slot
+		// can be reused, even if another texture got the same address.
+		std::weak_ptr<Texture::Data> source;
+
+		uint version;
+
+		Image page;
+
+		AtlasSlot slot;
+
+	};// AtlasEntry
+
+
+	struct TextureAtlas
+	{
+
+		std::vector<std::unique_ptr<AtlasPage>> pages;
+
+		std::unordered_map<const Texture::Data*, AtlasEntry> entries;
+
+		std::vector<AtlasSlot> free_slots;
+
+		const AtlasEntry* get (
+			const Image& image, const Texture& texture, Painter* painter)
+		{
+			int w = texture.width(), h = texture.height();
+			AtlasSlot slot;
+
+			auto it = entries.find(texture.self.get());
+			if (it != entries.end())
+			{
+				AtlasEntry& entry = it->second;
+				bool same_texture = !entry.source.expired();
+				if (same_texture && entry.version == Texture_get_version(texture))
+					return &entry;
+
+				// the modified texture is copied over its own slot again.
+				if (same_texture && fits(entry.slot, w, h, texture.smooth()))
+					slot = entry.slot;
+				else
+					free_slots.emplace_back(entry.slot);
+
+				entries.erase(it);
+			}
+
+			if (!slot.page && !allocate(&slot, w, h, texture.smooth()))
+			{
+				// every page is full; drop them all and start over. batches that
+				// still refer to the old pages keep their textures alive.
+				clear();
+
+				if (!allocate(&slot, w, h, texture.smooth()))
+					return NULL;
+			}
+
+			copy(&slot, image, w, h, painter);
+
+			AtlasEntry& entry = entries[texture.self.get()];
+			entry.source  = texture.self;
+			entry.version = Texture_get_version(texture);
+			entry.page    = slot.page->image;
+			entry.slot    = slot;
+			return &entry;
+		}
+
+		void clear ()
+		{
+			pages.clear();
+			entries.clear();
+			free_slots.clear();
+		}
+
+		static bool fits (const AtlasSlot& slot, int width, int height, bool smooth)
+		{
+			return
+				slot.page->image.smooth() == smooth &&
+				width <= slot.width && height <= slot.height;
+		}
+
+		bool allocate (AtlasSlot* slot, int width, int height, bool smooth)
+		{
+			assert(slot);
+
+			if (take_free_slot(slot, width, height, smooth))
+				return true;
+
+			slot->width  = width;
+			slot->height = height;
+
+			for (auto& page : pages)
+			{
+				if (page->image.smooth() != smooth) continue;
+				if (page->allocate(&slot->x, &slot->y, width, height))
+				{
+					slot->page = page.get();
+					return true;
+				}
+			}
+
+			if (pages.size() < PAGE_MAX)
+			{
+				pages.emplace_back(new AtlasPage(smooth));
+				AtlasPage* page = pages.back().get();
+				if (page->allocate(&slot->x, &slot->y, width, height))
+				{
+					slot->page = page;
+					return true;
+				}
+			}
+
+			// the pages are full; the slots of freed textures may still do.
+			return collect_expired_slots() && take_free_slot(slot, width, height, smooth);
+		}
+
+		bool take_free_slot (AtlasSlot* slot, int width, int height, bool smooth)
+		{
+			auto best = free_slots.end();
+			for (auto it = free_slots.begin(); it != free_slots.end(); ++it)
+			{
+				if (!fits(*it, width, height, smooth)) continue;
+				if (best == free_slots.end() || it->width * it->height < best->width * best->height)
+					best = it;
+			}
+			if (best == free_slots.end()) return false;
+
+			*slot = *best;
+			free_slots.erase(best);
+			return true;
+		}
+
+		bool collect_expired_slots ()
+		{
+			size_t nfree = free_slots.size();
+			for (auto it = entries.begin(); it != entries.end();)
+			{
+				if (it->second.source.expired())
+				{
+					free_slots.emplace_back(it->second.slot);
+					it = entries.erase(it);
+				}
+				else
+					++it;
+			}
+			return free_slots.size() > nfree;
+		}
+
+		void copy (
+			AtlasSlot* slot, const Image& image, int width, int height,
+			Painter* painter)
+		{
+			assert(slot);
+
+			// pending batches of the painter may still sample what was in the
+			// slot before, so they have to be drawn first.
+			if (slot->drawn)
+				Painter_flush(painter, FLUSH_TEXTURE);
+
+			Painter p = slot->page->image.painter();
+			p.begin();
+			p.set_blend_mode(BLEND_REPLACE);
+
+			// a reused slot may be larger than the image, and what is left of
+			// the previous image must not bleed into the edges of this one.
+			if (width < slot->width || height < slot->height)
+			{
+				p.set_fill(0, 0, 0, 0);
+				p.no_stroke();
+				p.rect(slot->x, slot->y, slot->width, slot->height);
+			}
+
+			Painter_draw_image(
+				&p, image,
+				0, 0, image.width(), image.height(),
+				slot->x, slot->y, width, height);
+			p.end();
+
+			slot->drawn = true;
+		}
+
+	};// TextureAtlas
+
+
+	static TextureAtlas*
+	get_atlas ()
+	{
+		static TextureAtlas atlas;
+		return &atlas;
+	}
+
+	bool
+	TextureAtlas_get (
+		Image* page, Point* offset, const Image& image, Painter* painter)
+	{
+		assert(page && offset && painter);
+
+		const Texture& texture = Image_get_texture(image);
+		if (!texture)
+			return false;
+
+		if (
+			texture.width()  > IMAGE_SIZE_MAX ||
+			texture.height() > IMAGE_SIZE_MAX)
+		{
+			return false;
+		}
+
+		const AtlasEntry* entry = get_atlas()->get(image, texture, painter);
+		if (!entry) return false;
+
+		*page = entry->page;
+		offset->reset(entry->slot.x, entry->slot.y);
+		return true;
+	}
+
+	void
+	TextureAtlas_clear ()
+	{
+		get_atlas()->clear();
+	}
+
+
+}// Rays
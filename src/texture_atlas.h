@@ -0,0 +1,33 @@
+// -*- c++ -*-
+#pragma once
+#ifndef __RAYS_SRC_TEXTURE_ATLAS_H__
+#define __RAYS_SRC_TEXTURE_ATLAS_H__
+
+
+#include "rays/defs.h"
+#include "rays/point.h"
+#include "rays/image.h"
+#include "rays/painter.h"
+
+
+namespace Rays
+{
+
+
+	// Copies small images into shared atlas pages on first use and returns
+	// the page and the pixel offset of the copy. The copy is refreshed when
+	// the source texture is modified. Returns false for images that are not
+	// worth packing, which have to be drawn from their own texture. The
+	// painter is flushed before a slot it may still sample is overwritten.
+	bool TextureAtlas_get (
+		Image* page, Point* offset, const Image& image, Painter* painter);
+
+	// Releases the pages. Slots of freed textures are reused while the atlas
+	// runs, so this is needed only before the GL context goes away.
+	void TextureAtlas_clear ();
+
+
+}// Rays
+
+
+#endif//EOH
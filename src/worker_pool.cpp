@@ -0,0 +1,180 @@
+#include "worker_pool.h"
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#ifndef WIN32
+	#include <pthread.h>
+#endif
+
+
+namespace Rays
+{
+
+
+	static thread_local bool in_task = false;
+
+
+	class WorkerPool
+	{
+
+		public:
+
+			void run (size_t ntasks, const std::function<void(size_t)>& task)
+			{
+				std::unique_lock<std::mutex> running(run_mutex, std::try_to_lock);
+				if (ntasks <= 1 || in_task || !running || !start_threads())
+				{
+					for (size_t i = 0; i < ntasks; ++i) task(i);
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					this->task   = &task;
+					this->ntasks = ntasks;
+					next         = 0;
+					nbusy        = threads.size();
+					error        = nullptr;
+					++generation;
+				}
+				wake.notify_all();
+
+				work();
+
+				std::unique_lock<std::mutex> lock(mutex);
+				done.wait(lock, [&]() {return nbusy == 0;});
+				this->task = NULL;
+
+				if (error) std::rethrow_exception(error);
+			}
+
+			size_t concurrency ()
+			{
+				return std::max(std::thread::hardware_concurrency(), 1u);
+			}
+
+		private:
+
+			std::vector<std::thread> threads;
+
+			std::mutex mutex, run_mutex;
+
+			std::condition_variable wake, done;
+
+			const std::function<void(size_t)>* task = NULL;
+
+			size_t ntasks = 0, nbusy = 0;
+
+			std::atomic<size_t> next {0};
+
+			std::exception_ptr error;
+
+			unsigned long long generation = 0;
+
+			bool started = false;
+
+			bool start_threads ()
+			{
+				if (!started)
+				{
+					started = true;
+
+					// the tasks run on the threads that could be started, or on
+					// the calling thread alone where threads are not available.
+					try
+					{
+						for (size_t i = 1; i < concurrency(); ++i)
+							threads.emplace_back([this]() {loop();});
+					}
+					catch (const std::system_error&)
+					{
+					}
+				}
+				return !threads.empty();
+			}
+
+			void loop ()
+			{
+				unsigned long long seen = 0;
+				std::unique_lock<std::mutex> lock(mutex);
+				while (true)
+				{
+					wake.wait(lock, [&]() {return generation != seen;});
+
+					seen = generation;
+					lock.unlock();
+					work();
+					lock.lock();
+
+					if (--nbusy == 0) done.notify_one();
+				}
+			}
+
+			void work ()
+			{
+				in_task = true;
+				try
+				{
+					for (size_t i; (i = next++) < ntasks;)
+						(*task)(i);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!error) error = std::current_exception();
+					next = ntasks;
+				}
+				in_task = false;
+			}
+
+	};// WorkerPool
+
+
+	// the pool is never destroyed, since its threads are kept until the
+	// process exits.
+	static WorkerPool* pool = NULL;
+
+	static void
+	reset_pool_in_child ()
+	{
+		// only the forking thread runs in the child, and the locks of the
+		// pool may have been held by the others. the pool is left as it is
+		// and a new one starts its threads on the first call.
+		pool = new WorkerPool;
+	}
+
+	static WorkerPool&
+	get_pool ()
+	{
+		static std::once_flag once;
+		std::call_once(once, []()
+		{
+			pool = new WorkerPool;
+		#ifndef WIN32
+			pthread_atfork(NULL, NULL, reset_pool_in_child);
+		#endif
+		});
+		return *pool;
+	}
+
+	void
+	WorkerPool_run (size_t ntasks, const std::function<void(size_t)>& task)
+	{
+		get_pool().run(ntasks, task);
+	}
+
+	size_t
+	WorkerPool_get_concurrency ()
+	{
+		return get_pool().concurrency();
+	}
+
+
+}// Rays
@@ -0,0 +1,32 @@
+// -*- c++ -*-
+#pragma once
+#ifndef __RAYS_SRC_WORKER_POOL_H__
+#define __RAYS_SRC_WORKER_POOL_H__
+
+
+#include <functional>
+#include "rays/defs.h"
+
+
+namespace Rays
+{
+
+
+	// Calls 'task' with each index in [0, ntasks) on the threads of the pool
+	// and on the calling thread, and returns when all of them are done. The
+	// threads are started on the first call and kept until the process exits.
+	// A forked child starts threads of its own, and the tasks run on the
+	// calling thread alone where no thread can be started.
+	// The tasks run on the calling thread alone if the pool is busy with the
+	// tasks of another call, or if it is called from a task.
+	void WorkerPool_run (size_t ntasks, const std::function<void(size_t)>& task);
+
+	// Returns the number of the threads that run the tasks, including the
+	// calling thread.
+	size_t WorkerPool_get_concurrency ();
+
+
+}// Rays
+
+
+#endif//EOH
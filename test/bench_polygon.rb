@@ -0,0 +1,90 @@
+%w[../xot ../rucy .]
+  .map  {|s| File.expand_path "../#{s}/lib", __dir__}
+  .each {|s| $:.unshift s if !$:.include?(s) && File.directory?(s)}
+
+require 'benchmark'
+require 'rays'
+
+
+# ruby test/bench_polygon.rb [NAME...]
+
+def measure(label, count, npoints, &block)
+  block.call # warm up
+  time = Benchmark.realtime {count.times(&block)}
+  puts "  %-28s %10.2f us/call %8.1f ns/point" % [
+    label, time / count * 1e6, time / count / npoints * 1e9]
+end
+
+def ngon(n, r = 1000)
+  (0...n).map {|i| a = Math::PI * 2 * i / n; [Math.cos(a) * r, Math.sin(a) * r]}
+end
+
+def zigzag(n)
+  [[0, 0], *(0...n - 2).map {|i| [100 + i % 2 * 10, i]}, [0, n]]
+end
+
+def star(n, r = 1000)
+  (0...n).map {|i|
+    a = Math::PI * 2 * i / n
+    rr = i.even? ? r : r / 2
+    [Math.cos(a) * rr, Math.sin(a) * rr]
+  }
+end
+
+def wave(n, size = 1000)
+  (0...n).map {|i| x = size.to_f * i / n; [x, size / 2 + Math.sin(x / 20) * size / 4]}
+end
+
+def paint(&block)
+  Rays::Image.new(1000, 1000).paint(&block)
+end
+
+BENCHES = {
+  stroke: -> {
+    puts 'stroke (native stroker, gpu extrusion, expand by clipper and fill)'
+    [1000, 4000, 16000].each do |n|
+      count  = [200_000 / n, 5].max
+      points = wave n
+      [[:butt, :miter], [:round, :round]].each do |cap, join|
+        {native: false, gpu: true}.each do |name, gpu|
+          paint do |p|
+            p.gpu_strokes = gpu
+            p.fill nil
+            p.stroke 1
+            p.stroke_width 8
+            p.stroke_cap cap
+            p.stroke_join join
+            measure "#{name} #{n} #{cap}/#{join}", count, n do
+              p.polygon Rays::Polygon.new(*points, loop: false)
+            end
+          end
+        end
+        paint do |p|
+          p.fill 1
+          p.stroke nil
+          measure "clipper #{n} #{cap}/#{join}", count, n do
+            p.polygon Rays::Polygon.new(*points, loop: false).expand(4, cap, join)
+          end
+        end
+      end
+    end
+  },
+
+  triangulate: -> {
+    puts 'triangulate (convex fan, y-monotone sweep, earcut)'
+    [64, 1024, 16384].each do |n|
+      count = [100_000 / n, 10].max
+      {convex: ngon(n), monotone: zigzag(n), earcut: star(n)}.each do |name, points|
+        measure "#{name} #{n}",     count, n do
+          Rays::Polygon.new(*points).triangulate
+        end
+        measure "#{name} #{n} (new only)", count, n do
+          Rays::Polygon.new(*points)
+        end
+      end
+    end
+  },
+}
+
+names = ARGV.empty? ? BENCHES.keys : ARGV.map(&:to_sym)
+names.each {|name| BENCHES.fetch(name).call}
@@ -243,6 +243,62 @@ class TestPainter < Test::Unit::TestCase
     assert_false pa.debug?
   end
 
+  def test_texture_atlas_accessor()
+    pa               = painter
+    assert_false pa.texture_atlas?
+    pa.texture_atlas = true
+    assert_true  pa.texture_atlas?
+    pa.texture_atlas = false
+    assert_false pa.texture_atlas?
+  end
+
+  def test_sdf_shapes_accessor()
+    pa            = painter
+    assert_false pa.sdf_shapes?
+    pa.sdf_shapes = true
+    assert_true  pa.sdf_shapes?
+    pa.sdf_shapes = false
+    assert_false pa.sdf_shapes?
+  end
+
+  def test_gpu_strokes_accessor()
+    pa             = painter
+    assert_false pa.gpu_strokes?
+    pa.gpu_strokes = true
+    assert_true  pa.gpu_strokes?
+    pa.gpu_strokes = false
+    assert_false pa.gpu_strokes?
+  end
+
+  def test_glyph_atlas_accessor()
+    pa             = painter
+    assert_false pa.glyph_atlas?
+    pa.glyph_atlas = true
+    assert_true  pa.glyph_atlas?
+    pa.glyph_atlas = false
+    assert_false pa.glyph_atlas?
+  end
+
+  def test_statistics()
+    pa = image(16, 16).painter
+    pa.paint do
+      fill 1, 0, 0
+      10.times {|i| rect i, 0, 1, 1}
+      blend_mode :add
+      rect 0, 1, 1, 1
+    end
+    st = pa.statistics
+    assert_equal 11, st[:draws]
+    assert_equal 11, st[:immediate_draws] + st[:batched_draws]
+    assert_operator st[:flushes], :>, 0
+    assert_equal 1, st[:flush_reasons][:blend]
+    assert_operator st[:uploaded_vertices], :>=, 44
+    assert_operator st[:uploaded_bytes],    :>,  0
+
+    pa.paint {}
+    assert_equal 0, pa.statistics[:draws]
+  end
+
   def test_color_by_name()
     pa = painter
     pa.fill =         :rgb001
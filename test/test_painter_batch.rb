@@ -237,6 +237,184 @@ class TestPainterBatch < Test::Unit::TestCase
     end
   end
 
+  def uniform_shader(batchable: true)
+    Rays::Shader.new <<~END, batchable: batchable
+      uniform float value;
+      void main() {gl_FragColor = vec4(value, 0.0, 1.0, 1.0);}
+    END
+  end
+
+  def test_match_shader_uniforms()
+    sh = uniform_shader
+    assert_equal_batched_and_unbatched(32, 16) do
+      32.times do |i|
+        shader sh, value: i / 32.0 if i % 8 == 0
+        rect i, 0, 1, 16
+      end
+    end
+  end
+
+  def test_match_shader_uniforms_changed_by_other_painter()
+    sh = uniform_shader
+    assert_equal_batched_and_unbatched(16, 16) do
+      shader sh, value: 0.25
+      16.times {|i| rect i, 0, 1, 8}
+      Rays::Image.new(4, 4).paint {shader sh, value: 1; rect 0, 0, 4, 4}
+      16.times {|i| rect i, 8, 1, 8}
+    end
+  end
+
+  def test_batchable_shader()
+    draw = -> sh {
+      img = Rays::Image.new 16, 16
+      img.paint do |p|
+        p.shader sh, value: 0.5
+        16.times {|i| p.shader sh, value: 0.5; p.rect i, 0, 1, 16}
+      end
+      img.painter.statistics
+    }
+    draw[uniform_shader batchable: true].tap do |st|
+      assert_true  st[:batched_draws] > 0
+      assert_equal 0, st[:flush_reasons][:uniform]
+    end
+    assert_equal 0, draw[uniform_shader batchable: false][:batched_draws]
+  end
+
+  def test_match_shader_colors()
+    assert_equal_batched_and_unbatched(16, 16) do
+      shader <<~END
+        varying vec4 v_Color;
+        void main() {gl_FragColor = vec4(v_Color.rgb / 4.0, 1.0);}
+      END
+      16.times do |i|
+        fill i / 4.0, 0.3 + i / 1000.0, 4 - i / 4.0
+        rect i, 0, 1, 16
+      end
+    end
+  end
+
+  def test_match_shader_using_position()
+    assert_equal_batched_and_unbatched(16, 16) do
+      shader <<~END
+        varying vec4 v_Position;
+        void main() {gl_FragColor = vec4(v_Position.xy / 16.0, 0.0, 1.0);}
+      END
+      translate 4, 4
+      8.times {|i| rect i, 0, 1, 8}
+    end
+  end
+
+  def test_match_hairlines()
+    assert_equal_batched_and_unbatched(16, 16) do
+      stroke 1, 0, 0
+      stroke_width 0
+      16.times {|i| line i, 0, i, 16}
+      no_fill
+      stroke 0, 1, 0
+      rect 2, 2, 12, 12
+      fill 0, 0, 1
+      stroke nil
+      rect 4, 4, 8, 8
+      stroke 1
+      line 0, 15, 8, 8, 15, 15, loop: true
+    end
+  end
+
+  def test_match_bulk_shapes()
+    bounds = [[0, 0, 8, 8], [8, 0, 8, 8], [0, 8, 16, 8]]
+    colors = [[1, 0, 0], [0, 1, 0], [0, 0, 1]]
+    draw   = -> p, bulk {
+      if bulk
+        p.rects    bounds, colors: colors
+        p.ellipses bounds.map {|x, y, w, h| Rays::Bounds.new x, y, w, h}
+      else
+        bounds.zip(colors).each {|b, c| p.fill(*c); p.rect(*b)}
+        p.fill 1
+        bounds.each {|b| p.ellipse(*b)}
+      end
+    }
+    bulk    = image(16, 16) {|p| p.fill 1; draw[p, true]}
+    single  = image(16, 16) {|p| p.fill 1; draw[p, false]}
+    assert_equal single.bitmap.pixels, bulk.bitmap.pixels
+  end
+
+  def test_match_bulk_images()
+    src  = image(4, 4) {fill 1, 0, 0; rect 0, 0, 2, 4; fill 0, 0, 1; rect 2, 0, 2, 4}
+    dest = [[0, 0, 8, 8], [8, 0, 8, 8], [0, 8, 16, 8]]
+    srcs = [[0, 0, 2, 4], [2, 0, 2, 4], [0, 0, 4, 4]]
+    draw = -> p, bulk {
+      if bulk
+        p.images src, dest.flatten, src: srcs.flatten
+      else
+        dest.zip(srcs).each {|d, s| p.image src, *s, *d}
+      end
+    }
+    [false, true].each do |atlas|
+      bulk    = image(16, 16) {|p| p.texture_atlas = atlas; draw[p, true]}
+      single  = image(16, 16) {|p| p.texture_atlas = atlas; draw[p, false]}
+      assert_equal single.bitmap.pixels, bulk.bitmap.pixels
+    end
+  end
+
+  def test_match_texts()
+    assert_equal_batched_and_unbatched(64, 32) do
+      fill 1
+      text "abc",  0,  0
+      text "cab", 24,  0
+      fill 1, 0, 0
+      text "bca",  0, 16
+    end
+  end
+
+  def test_match_glyph_atlas_texts()
+    assert_equal_batched_and_unbatched(64, 32) do
+      self.glyph_atlas = true
+      fill 1
+      text "abc",  0,  0
+      text "cab", 24,  0
+      fill 1, 0, 0
+      text "bca",  0, 16
+    end
+  end
+
+  def test_match_texture_atlas()
+    r, g, b = [[1, 0, 0], [0, 1, 0], [0, 0, 1]].map {|c| image(4, 4, bg: c)}
+    draw    = -> p {
+      p.image r, 0, 0
+      p.image g, 4, 0, 8, 8
+      p.image b, 0, 0, 2, 2, 12, 0, 4, 4
+    }
+    atlas   = image(16, 8) {|p| p.texture_atlas = true; draw[p]}
+    plain   = image(16, 8) {|p| draw[p]}
+    assert_equal plain.bitmap.pixels, atlas.bitmap.pixels
+
+    g.paint {background 1, 1, 0}
+    atlas   = image(16, 8) {|p| p.texture_atlas = true; draw[p]}
+    assert_rgb [1, 1, 0], atlas[8, 4]
+  end
+
+  def test_texture_atlas_reuses_slots()
+    img   = image(4, 4, bg: [1, 0, 0])
+    atlas = image(8, 4) do |p|
+      p.texture_atlas = true
+      p.image img, 0, 0
+      img.paint {background 0, 0, 1}
+      p.image img, 4, 0
+    end
+    assert_rgb [1, 0, 0], atlas[1, 1]
+    assert_rgb [0, 0, 1], atlas[5, 1]
+
+    small = image(2, 2, bg: [0, 1, 0])
+    img.paint {background 1, 1, 0}
+    atlas = image(8, 4) do |p|
+      p.texture_atlas = true
+      p.image small, 0, 0
+      p.image img,   4, 0
+    end
+    assert_rgb [0, 1, 0], atlas[1, 1]
+    assert_rgb [1, 1, 0], atlas[5, 1]
+  end
+
   def test_atlas_no_bleed()
     atlas = image(4, 2) do
       fill 1, 0, 0; rect 0, 0, 2, 2
@@ -97,4 +97,163 @@ class TestPainterShape < Test::Unit::TestCase
     assert_equal 0, img[99, 99].a
   end
 
+  def test_polygon_stroke_with_cached_outline()
+    rect = -> {Rays::Polygon.rect 10, 10, 80, 80, round: 8}
+    poly = rect[]
+    [[4, :miter], [4, :miter], [10, :round], [4, :miter]].each do |width, join|
+      draw   = -> pl {
+        image(0, 1) {stroke_width width; stroke_join join; polygon pl}
+      }
+      assert_equal draw[rect[]].pixels, draw[poly].pixels
+    end
+  end
+
+  def test_shapes_match_polygons()
+    [[1, 0], [1, 1], [0, 1]].each do |fill, stroke|
+      shapes   = image(fill, stroke) {
+        rect    10, 10, 30, 20
+        ellipse 50, 10, 40, 30
+        line    10, 60, 90, 90, 10, 90, loop: true
+        point   5, 95
+      }
+      polygons = image(fill, stroke) {
+        polygon Rays::Polygon.rect(   10, 10, 30, 20)
+        polygon Rays::Polygon.ellipse(50, 10, 40, 30)
+        polygon Rays::Polygon.line(   10, 60, 90, 90, 10, 90, loop: true)
+        polygon Rays::Polygon.points( 5, 95)
+      }
+      assert_equal polygons.pixels, shapes.pixels
+    end
+  end
+
+  def test_shapes_reuse_buffers()
+    pa   = Rays::Image.new(100, 100).painter
+    draw = -> {
+      pa.paint do
+        fill 1
+        stroke 0.5
+        100.times do |i|
+          rect    i, i, 10, 10
+          ellipse i, i, 10, 10
+          line    0, i, 99, i
+          point   i, 0
+        end
+      end
+      pa.statistics[:buffer_growths]
+    }
+    assert_operator draw.call, :>, 0
+    assert_equal 0, draw.call
+  end
+
+  def test_bulk_ellipses_reuse_buffers()
+    pa     = Rays::Image.new(100, 100).painter
+    bounds = 10.times.map {|i| Rays::Bounds.new i * 10, 0, 10, 10}
+    draw   = -> {
+      pa.paint {fill 1; stroke nil; 10.times {ellipses bounds}}
+      pa.statistics[:buffer_growths]
+    }
+    assert_operator draw.call, :>, 0
+    assert_equal 0, draw.call
+  end
+
+  def test_polygon_convex_and_monotone()
+    poly    = Rays::Polygon.new 50, 10, 85, 30, 85, 70, 50, 90, 15, 70, 15, 30
+    hexagon = image {polygon poly}
+    assert_equal 1, hexagon[50, 50].a
+    assert_equal 1, hexagon[20, 50].a
+    assert_equal 0, hexagon[16, 20].a
+
+    poly = Rays::Polygon.new 10, 10, 90, 10, 90, 90, 10, 90, 50, 70, 10, 50, 50, 30
+    comb = image {polygon poly}
+    assert_equal 1, comb[20, 50].a
+    assert_equal 1, comb[60, 70].a
+    assert_equal 0, comb[20, 70].a
+    assert_equal 0, comb[20, 30].a
+  end
+
+  def test_polygon_with_many_outlines()
+    rings = (0...100).map {|i|
+      Rays::Polygon.ellipse(
+        i % 10 * 10, i / 10 * 10, 10, 10, hole: [4, 4], nsegment: 32)
+    }
+    whole = rings.reduce {|a, b| a + b}
+    assert_true whole.map(&:size).sum >= 4096
+
+    assert_equal(
+      image {rings.each {|ring| polygon ring}}.pixels,
+      image {polygon whole}.pixels)
+  end
+
+  def test_sdf_shapes()
+    img = image {
+      self.sdf_shapes = true
+      rect    10, 10, 40, 30, round: 8
+      ellipse 50,  0, 50, 50, hole: 20
+      ellipse  0, 50, 50, 50, from: 0, to: 90
+    }
+    assert_equal 0, img[ 5,  5].a
+    assert_equal 0, img[11, 11].a
+    assert_equal 1, img[30, 25].a
+    assert_equal 1, img[75,  5].a
+    assert_equal 0, img[75, 25].a
+    assert_equal 1, img[35, 65].a
+    assert_equal 0, img[15, 65].a
+    assert_equal 0, img[15, 85].a
+
+    img = image(0, 1) {self.sdf_shapes = true; stroke_width 4; rect 60, 60, 30, 30}
+    assert_equal 0, img[58, 75].a
+    assert_equal 1, img[61, 75].a
+    assert_equal 0, img[75, 75].a
+  end
+
+  def test_stroke_joins_and_caps()
+    draw = -> join, cap = :butt {
+      image(0, 1) {
+        stroke_width 10
+        stroke_join  join
+        stroke_cap   cap
+        line 20, 20, 80, 20, 80, 80
+      }
+    }
+    assert_equal 1, draw[:miter] [84, 16].a
+    assert_equal 0, draw[:round] [84, 16].a
+    assert_equal 1, draw[:round] [80, 15].a
+    assert_equal 0, draw[:square][84, 16].a
+    assert_equal 1, draw[:square][80, 15].a
+    assert_equal 1, draw[:miter] [74, 24].a
+    assert_equal 0, draw[:miter] [17, 20].a
+    assert_equal 1, draw[:miter, :square][16, 16].a
+    assert_equal 1, draw[:miter, :round] [17, 20].a
+    assert_equal 0, draw[:miter, :round] [15, 15].a
+  end
+
+  def test_translucent_stroke_blends_once()
+    img = image(0, 1) {
+      stroke       1, 1, 1, 0.5
+      stroke_width 10
+      line 20, 50, 50, 50, 51, 60, 52, 50, 80, 50
+    }
+    [[30, 50], [51, 52], [51, 56], [70, 50]].each do |x, y|
+      assert_in_delta 0.5, img[x, y].a, 0.02, "at #{x}, #{y}"
+    end
+  end
+
+  def test_gpu_strokes()
+    draw = -> cap, gpu = true {
+      image(0, 1) {
+        self.gpu_strokes = gpu
+        stroke_width 10
+        stroke_cap   cap
+        line 20, 50, 80, 50
+      }
+    }
+    assert_equal draw[:butt, false].pixels, draw[:butt].pixels
+    assert_equal 1, draw[:butt]  [50, 46].a
+    assert_equal 0, draw[:butt]  [50, 44].a
+    assert_equal 0, draw[:butt]  [17, 50].a
+    assert_equal 1, draw[:square][15, 45].a
+    assert_equal 1, draw[:round] [17, 50].a
+    assert_equal 0, draw[:round] [15, 45].a
+  end
+
 end# TestPainterShape
@@ -0,0 +1,113 @@
+require_relative 'helper'
+
+
+class TestPicture < Test::Unit::TestCase
+
+  def picture(w = 16, h = 16, &block)
+    Rays::Picture.new(w, h).tap {|pic| pic.paint {instance_eval(&block)} if block}
+  end
+
+  def image(w = 16, h = 16, &block)
+    Rays::Image.new(w, h).paint {background 0; stroke nil; instance_eval(&block)}
+  end
+
+  def assert_equal_pixels(expected, actual)
+    assert_equal expected.bitmap.pixels, actual.bitmap.pixels, "Pixel mismatch"
+  end
+
+  def test_initialize()
+    assert_equal 10, picture(10, 20).width
+    assert_equal 20, picture(10, 20).height
+    assert_true      picture.empty?
+    assert_raise(ArgumentError) {Rays::Picture.new 0, 10}
+  end
+
+  def test_dup()
+    o = picture {fill 1; rect 0, 0, 8, 8}
+    x = o.dup
+    o.clear
+    assert_true  o.empty?
+    assert_false x.empty?
+  end
+
+  def test_merge_draws()
+    pic = picture do
+      fill 1, 0, 0
+      rect 0, 0, 8, 8
+      fill 0, 1, 0
+      ellipse 8, 8, 8, 8
+    end
+    assert_equal 1, pic.size
+
+    pic = picture do
+      rect 0, 0, 8, 8
+      blend_mode :add
+      rect 8, 8, 8, 8
+    end
+    assert_equal 2, pic.size
+  end
+
+  def test_clear()
+    pic = picture do
+      fill 1, 0, 0
+      rect 0, 0, 8, 8
+      background 0, 0, 1
+      fill 0, 1, 0
+      rect 0, 0, 4, 4
+    end
+    assert_equal 2, pic.size
+    assert_equal_pixels(
+      image {background 0, 0, 1; fill 0, 1, 0; rect 0, 0, 4, 4},
+      image {picture pic})
+  end
+
+  def test_draw()
+    src  = image(4, 4) {fill 1, 0, 0; rect 0, 0, 2, 4; fill 0, 0, 1; rect 2, 0, 2, 4}
+    draw = -> p {
+      p.fill 1, 0, 0
+      p.rect 0, 0, 6, 6
+      p.stroke 0, 1, 0
+      p.stroke_width 2
+      p.ellipse 6, 2, 8, 8
+      p.no_stroke
+      p.image src, 0, 8, 8, 8
+      p.fill 1
+      p.text "a", 8, 0
+    }
+    pic  = picture(&draw)
+    assert_equal_pixels image {draw[self]},                 image {picture pic}
+    assert_equal_pixels image {translate 2, 1; draw[self]}, image {picture pic, 2, 1}
+  end
+
+  def test_draw_nested()
+    inner = picture {fill 1, 0, 0; rect 0, 0, 4, 4}
+    outer = picture {picture inner, 2, 2; picture inner, 8, 8}
+    assert_equal_pixels(
+      image {fill 1, 0, 0; rect 2, 2, 4, 4; rect 8, 8, 4, 4},
+      image {picture outer})
+  end
+
+  def test_draw_without_batching()
+    pic = picture do
+      16.times {|i| fill i / 16.0, 0, 0; rect i, 0, 1, 16}
+      blend_mode :add
+      rect 0, 0, 8, 8
+    end
+    img = Rays::Image.new(16, 16)
+    img.paint {picture pic}
+    st = img.painter.statistics
+    assert_equal 0,        st[:batched_draws]
+    assert_equal pic.size, st[:draw_calls]
+  end
+
+  def test_keep_painter_state()
+    pic = picture {blend_mode :add; fill 1, 0, 0; rect 0, 0, 4, 4}
+    Rays::Image.new(16, 16).paint do |pa|
+      pa.fill 0, 1, 0
+      pa.picture pic
+      assert_equal :normal,                     pa.blend_mode
+      assert_equal Rays::Color.new(0, 1, 0, 1), pa.fill
+    end
+  end
+
+end# TestPicture
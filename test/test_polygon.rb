@@ -1,3 +1,4 @@
+require 'timeout'
 require_relative 'helper'
 
 
@@ -108,6 +109,91 @@ class TestPolygon < Test::Unit::TestCase
     assert_not polygon()                      .bounds.valid?
   end
 
+  def test_contains()
+    ring = rect(0, 0, 10, 10) - rect(3, 3, 4, 4)
+    assert_true  ring.contains?(1, 1)
+    assert_true  ring.contains?(point 8, 5)
+    assert_false ring.contains?(5, 5)
+    assert_false ring.contains?(11, 5)
+    assert_false polygon.contains?(0, 0)
+
+    assert_equal [true, false, false], ring.contains_points([[1, 1], [5, 5], [-1, 5]])
+    assert_equal [],                   ring.contains_points([])
+
+    grid = (0...30).map {|i| rect i % 6 * 10, i / 6 * 10, 5, 5}.reduce :+
+    assert_true  grid.contains?(12, 22)
+    assert_false grid.contains?(17, 22)
+  end
+
+  def test_near_outline?()
+    r = rect 0, 0, 10, 10
+    assert_true  r.near_outline?(5, 0, 0.5)
+    assert_true  r.near_outline?(point(5, 11), 1)
+    assert_false r.near_outline?(5, 5, 1)
+    assert_false r.near_outline?(5, 12, 1)
+    assert_true  polygon(0, 0, 10, 10, loop: false).near_outline?(5, 6, 1)
+    assert_raise(ArgumentError) {r.near_outline?(0, 0, -1)}
+  end
+
+  def test_triangulate()
+    area = -> points {
+      points.each_slice(3).sum {|a, b, c|
+        ((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)).abs / 2
+      }
+    }
+    ngon = -> n {
+      (0...n).map {|i| r = Math::PI * 2 * i / n; [Math.cos(r) * 50, Math.sin(r) * 50]}
+    }
+    assert_triangles = -> poly, count, expected_area {
+      points = poly.triangulate
+      assert_equal count * 3, points.size
+      assert_in_delta expected_area, area[points], 0.01
+    }
+
+    # convex
+    assert_triangles[polygon(0, 0, 10, 0, 0, 10), 1, 50]
+    assert_triangles[rect(0, 0, 10, 20),          2, 200]
+    [5, 7, 64].each do |n|
+      assert_triangles[polygon(*ngon[n]), n - 2, n * 50 * 50 * Math.sin(Math::PI * 2 / n) / 2]
+    end
+
+    # monotone
+    zigzag = (0..10).map {|i| [10 + i % 2 * 5, i * 10]}
+    assert_triangles[polygon([0, 0], *zigzag, [0, 100]),               11, 1250]
+    assert_triangles[polygon(0, 0, 100, 0, 60, 50, 100, 100, 0, 100),  3, 8000]
+
+    # monotone chains that cross each other must not overlap the triangles
+    crossed = polygon(50, 0, 100, 30, 0, 70, 50, 100, 100, 70, 0, 30).triangulate
+    assert_operator area[crossed], :<=, 5000 + 0.01
+
+    # neither
+    assert_triangles[polygon(0, 0, 50, 30, 100, 0, 50, 100), 2, 3500]
+    assert_triangles[rect(0, 0, 10, 10) - rect(3, 3, 4, 4),  8, 84]
+
+    assert_equal [], polygon.triangulate
+  end
+
+  def test_triangulate_in_forked_child()
+    omit 'fork is not available' unless Process.respond_to? :fork
+
+    # enough outlines and points to triangulate on the worker pool
+    big = -> {
+      polygon(*(0...1024).map {|i|
+        Rays::Polyline.new(i * 2, 0, i * 2 + 1, 0, i * 2 + 1, 1, i * 2, 1, loop: true)
+      })
+    }
+    assert_equal 1024 * 6, big[].triangulate.size
+
+    pid = fork {exit! big[].triangulate.size == 1024 * 6}
+    begin
+      _, status = Timeout.timeout(10) {Process.wait2 pid}
+      assert_true status.success?
+    rescue Timeout::Error
+      Process.kill :KILL, pid
+      flunk 'the forked child hung on the worker pool'
+    end
+  end
+
   def test_loop()
     assert_equal true,  polygon(1, 2, 3, 4, 5, 6             ).first.loop?
     assert_equal true,  polygon(1, 2, 3, 4, 5, 6, loop: true ).first.loop?
@@ -235,4 +321,28 @@ class TestPolygon < Test::Unit::TestCase
     assert_equal_polygon polygon(), rect10    ^ rect10
   end
 
+  def test_unite()
+    rects = (0...8).map {|i| rect i * 5, 0, 10, 10}
+    assert_equal_polygon rect(0, 0, 45, 10), Rays::Polygon.unite(rects)
+    assert_equal_polygon rect(0, 0, 45, 10), Rays::Polygon.unite(*rects)
+    assert_equal_polygon rect(0, 0, 10, 10), Rays::Polygon.unite(rects[0])
+    assert_equal_polygon polygon(),          Rays::Polygon.unite([])
+
+    ring = rect(0, 0, 30, 30) - rect(10, 10, 10, 10)
+    assert_equal_polygon(
+      (rect(0, 0, 30, 30) | rect(40, 0, 10, 10)) - rect(10, 10, 10, 10),
+      Rays::Polygon.unite(ring, rect(40, 0, 10, 10)))
+    assert_equal_polygon rect(0, 0, 30, 30),
+      Rays::Polygon.unite(ring, rect(5, 5, 20, 20))
+  end
+
+  def test_intersect()
+    rects = (0...8).map {|i| rect i, i, 10, 10}
+    assert_equal_polygon rect(7, 7, 3, 3),   Rays::Polygon.intersect(rects)
+    assert_equal_polygon rect(0, 0, 10, 10), Rays::Polygon.intersect(rects[0])
+    assert_equal_polygon polygon(),          Rays::Polygon.intersect([])
+    assert_equal_polygon polygon(),
+      Rays::Polygon.intersect(rects + [rect(20, 20, 10, 10)])
+  end
+
 end# TestPolygon
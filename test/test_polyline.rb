@@ -85,6 +85,8 @@ class TestPolyline < Test::Unit::TestCase
 
     assert_true  polyline(               loop: true, hole: true) .hole?
     assert_false polyline(               loop: true, hole: false).hole?
+
+    assert_equal [[1,2], [3,4], [5,6]], dump(polyline(1,2, 3,4, 5,6, loop: true, hole: true))
   end
 
   def test_initialize_errors()